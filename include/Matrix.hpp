@@ -2,21 +2,300 @@
 #ifndef JUMBATM_MATRIX_HPP_INCLUDED  // Begin Header guard.
 #define JUMBATM_MATRIX_HPP_INCLUDED
 
-#include <array>
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <initializer_list>
-#include <iostream>
+#include <iterator>
 #include <stdexcept>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 
+#ifdef MAT_INSTRUMENTATION
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <typeinfo>
+#include <vector>
+
+#define EXCEPT_ASSERT(x)                                    \
+  (::mat::instrumentation::detail::countRuntimeAssertion(), \
+   (void)(!(x) ? throw std::runtime_error("mat: Assertion failed: " #x) : 0))
+#else
 #define EXCEPT_ASSERT(x) \
   (void)(!(x) ? throw std::runtime_error("mat: Assertion failed: " #x) : 0)
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MAT_SIMD_X86 1
+#endif
+
+// For helpers called from the SIMD kernels, so that they are compiled for the
+// kernel's instruction set rather than the baseline one.
+#if defined(__GNUC__)
+#define MAT_ALWAYS_INLINE __attribute__((always_inline)) inline
+#else
+#define MAT_ALWAYS_INLINE inline
+#endif
 
 namespace mat
 {
+/********************************************************************************
+ * Runtime SIMD dispatch.
+ *
+ * Materialisation kernels are compiled once per instruction set level, and the
+ * best level the CPU supports is picked on first use. The MAT_SIMD_LEVEL
+ * environment variable ("baseline"/"sse2", "avx2" or "avx512") lowers it, for
+ * testing and benchmarking each path. A level above what the CPU supports is
+ * clamped down, rather than faulting on an illegal instruction.
+ *******************************************************************************/
+enum class simd_level
+{
+  BASELINE,  // Whatever the compiler targets by default; SSE2 on x86-64.
+  AVX2,
+  AVX512
+};
+
+inline simd_level supportedSimdLevel()
+{
+#ifdef MAT_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return simd_level::AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return simd_level::AVX2;
+#endif
+  return simd_level::BASELINE;
+}
+
+namespace detail
+{
+inline simd_level initialSimdLevel()
+{
+  const simd_level supported = supportedSimdLevel();
+  const char *requested      = std::getenv("MAT_SIMD_LEVEL");
+
+  if (requested == nullptr)
+    return supported;
+  if (!std::strcmp(requested, "baseline") || !std::strcmp(requested, "sse2"))
+    return simd_level::BASELINE;
+  if (!std::strcmp(requested, "avx2"))
+    return std::min(supported, simd_level::AVX2);
+  if (!std::strcmp(requested, "avx512"))
+    return std::min(supported, simd_level::AVX512);
+  return supported;  // Unrecognised; ignore it.
+}
+
+inline std::atomic<simd_level> &activeSimdLevel()
+{
+  static std::atomic<simd_level> level(initialSimdLevel());
+  return level;
+}
+}  // end namespace detail
+
+inline simd_level simdLevel()
+{
+  return detail::activeSimdLevel().load(std::memory_order_relaxed);
+}
+
+// Returns the level actually in use, which is clamped to what the CPU supports.
+inline simd_level setSimdLevel(const simd_level level)
+{
+  const simd_level clamped = std::min(level, supportedSimdLevel());
+  detail::activeSimdLevel().store(clamped, std::memory_order_relaxed);
+  return clamped;
+}
+
+#ifdef MAT_INSTRUMENTATION
+/********************************************************************************
+ * Evaluation instrumentation. Only compiled in if MAT_INSTRUMENTATION is defined
+ * before including this header; otherwise none of this exists and evaluation
+ * is untouched.
+ *
+ * Every materialisation (construction of a Matrix from an expression) is
+ * counted per expression type, along with the elements and bytes it wrote and
+ * the time it took. A hook can be installed to observe each one as it happens.
+ *******************************************************************************/
+namespace instrumentation
+{
+struct event
+{
+  const char *expression;  // typeid(E).name() of the expression evaluated.
+  size_t elements;
+  size_t bytes;
+  std::chrono::nanoseconds duration;
+};
+
+struct snapshot
+{
+  const char *expression;
+  uint64_t materialisations;
+  uint64_t elements;
+  uint64_t bytes;
+  std::chrono::nanoseconds duration;
+};
+
+using hook_type = void (*)(const event &);
+
+namespace detail
+{
+struct counters
+{
+  const char *expression = nullptr;
+  std::atomic<uint64_t> materialisations{ 0 };
+  std::atomic<uint64_t> elements{ 0 };
+  std::atomic<uint64_t> bytes{ 0 };
+  std::atomic<uint64_t> nanoseconds{ 0 };
+};
+
+struct registry
+{
+  std::mutex lock;
+  std::deque<counters> entries;  // deque, so that references stay valid.
+  std::atomic<uint64_t> assertions{ 0 };
+  std::atomic<hook_type> hook{ nullptr };
+
+  static registry &get()
+  {
+    static registry instance;
+    return instance;
+  }
+};
+
+inline void countAssertion()
+{
+  registry::get().assertions.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Checks made during constant evaluation aren't counted, so that turning the
+// instrumentation on doesn't change which programs compile.
+constexpr void countRuntimeAssertion()
+{
+  if (!__builtin_is_constant_evaluated())
+  {
+    countAssertion();
+  }
+}
+
+template <typename E>
+counters &countersFor()
+{
+  static counters &entry = []() -> counters & {
+    registry &r = registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    counters &c = r.entries.emplace_back();
+    c.expression = typeid(E).name();
+    return c;
+  }();
+  return entry;
+}
+
+// Times and records one materialisation for as long as it is in scope.
+template <typename E>
+class _materialisationScope
+{
+  const size_t m_elements;
+  const size_t m_bytes;
+  const std::chrono::steady_clock::time_point m_start;
+
+public:
+  _materialisationScope(const size_t elements, const size_t bytes)
+    : m_elements(elements)
+    , m_bytes(bytes)
+    , m_start(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~_materialisationScope()
+  {
+    const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_start);
+
+    counters &c = countersFor<E>();
+    c.materialisations.fetch_add(1, std::memory_order_relaxed);
+    c.elements.fetch_add(m_elements, std::memory_order_relaxed);
+    c.bytes.fetch_add(m_bytes, std::memory_order_relaxed);
+    c.nanoseconds.fetch_add(duration.count(), std::memory_order_relaxed);
+
+    if (hook_type hook = registry::get().hook.load(std::memory_order_acquire))
+    {
+      hook(event{ c.expression, m_elements, m_bytes, duration });
+    }
+  }
+};
+}  // end namespace detail
+
+// Installs a hook called after every materialisation, returning the previous
+// one. Pass nullptr to remove it. The hook may be called from any thread.
+inline hook_type setHook(const hook_type hook)
+{
+  return detail::registry::get().hook.exchange(hook, std::memory_order_acq_rel);
+}
+
+inline uint64_t assertions()
+{
+  return detail::registry::get().assertions.load(std::memory_order_relaxed);
+}
+
+// Counters for every expression type materialised so far.
+inline std::vector<snapshot> counters()
+{
+  detail::registry &r = detail::registry::get();
+  std::lock_guard<std::mutex> guard(r.lock);
+
+  std::vector<snapshot> result;
+  for (auto &c : r.entries)
+  {
+    result.push_back(
+        { c.expression,
+          c.materialisations.load(std::memory_order_relaxed),
+          c.elements.load(std::memory_order_relaxed),
+          c.bytes.load(std::memory_order_relaxed),
+          std::chrono::nanoseconds(
+              c.nanoseconds.load(std::memory_order_relaxed)) });
+  }
+  return result;
+}
+
+template <typename E>
+snapshot countersFor()
+{
+  auto &c = detail::countersFor<E>();
+  return { c.expression,
+           c.materialisations.load(std::memory_order_relaxed),
+           c.elements.load(std::memory_order_relaxed),
+           c.bytes.load(std::memory_order_relaxed),
+           std::chrono::nanoseconds(
+               c.nanoseconds.load(std::memory_order_relaxed)) };
+}
+
+inline void reset()
+{
+  detail::registry &r = detail::registry::get();
+  std::lock_guard<std::mutex> guard(r.lock);
+
+  for (auto &c : r.entries)
+  {
+    c.materialisations = 0;
+    c.elements         = 0;
+    c.bytes            = 0;
+    c.nanoseconds      = 0;
+  }
+  r.assertions = 0;
+}
+}  // end namespace instrumentation
+#endif  // MAT_INSTRUMENTATION
+
 namespace detail
 {
+// Writes every element of expr into out, in row-major order.
+template <typename T, size_t Rows, size_t Columns, typename E>
+void _evaluate(T *out, const E &expr);
+
 template <typename E>
 class _expression
 {
@@ -47,7 +326,9 @@ class Matrix : public detail::_expression<Matrix<T, Rows, Columns>>
 {
   static_assert(std::is_arithmetic_v<T>, "Do not use user-defined classes.");
 
-  std::array<T, Rows *Columns> m_data = {};
+  // A plain array rather than std::array: constant-evaluating the initializer
+  // list constructors then doesn't go through a member call per element.
+  T m_data[Rows * Columns] = {};
 
   using this_type = Matrix<T, Rows, Columns>;
   using data_type = decltype(m_data);
@@ -73,22 +354,28 @@ public:
       }
   }
 
-  // If we're provided with a single dimension, assume that it's a row vector.
-  // That way, column vectors can be declared like:
-  // { {1},
-  //   {2},
-  //   {3} };
-  constexpr Matrix(const std::initializer_list<T> &init) : m_data(init) {}
+  // If we're provided with a single dimension, fill the elements in row-major
+  // order. For a row or column vector, that's just the vector's elements:
+  // { 1, 2, 3 };
+  constexpr Matrix(const std::initializer_list<T> &init)
+  {
+    EXCEPT_ASSERT(init.size() <= Rows * Columns);
+
+    size_t index = 0;
+    for (auto &value : init)
+    {
+      m_data[index++] = value;
+    }
+  }
   // Construct from an expression.
 
   template <typename MatrixType>
   constexpr Matrix(const detail::_expression<MatrixType> &expr)
   {
-    for (size_t i = 1; i <= rows(); ++i)
-      for (size_t j = 1; j <= cols(); ++j)
-      {
-        m_data[convertToFlatIndex(i, j)] = expr.at(i, j);
-      }
+    static_assert(MatrixType::rows() == Rows && MatrixType::cols() == Columns,
+                  "Expression does not evaluate to a matrix of this size.");
+    detail::_evaluate<T, Rows, Columns>(
+        m_data, static_cast<const MatrixType &>(expr));
   }
 
   /*******************************************************************************
@@ -104,12 +391,12 @@ public:
   }
   T &at(const size_t rowIndex, const size_t columnIndex)
   {
-    return m_data.at(convertToFlatIndex(rowIndex, columnIndex));
+    return m_data[convertToFlatIndex(rowIndex, columnIndex)];
   }
 
   T at(const size_t rowIndex, const size_t columnIndex) const
   {
-    return m_data.at(convertToFlatIndex(rowIndex, columnIndex));
+    return m_data[convertToFlatIndex(rowIndex, columnIndex)];
   }
 
   constexpr static size_t rows()
@@ -125,11 +412,22 @@ public:
    ******************************************************************************/
   auto begin()
   {
-    return m_data.begin();
+    return std::begin(m_data);
   }
   auto end()
   {
-    return m_data.end();
+    return std::end(m_data);
+  }
+  /*******************************************************************************
+   * Raw row-major storage, for kernels.
+   ******************************************************************************/
+  T *data()
+  {
+    return m_data;
+  }
+  const T *data() const
+  {
+    return m_data;
   }
   /*******************************************************************************
    * Convenience typedefs.
@@ -187,6 +485,39 @@ enum class _operation
   CROSS_PRODUCT
 };
 
+enum class _comparison
+{
+  LESS,
+  LESS_EQUAL,
+  GREATER,
+  GREATER_EQUAL,
+  EQUAL,
+  NOT_EQUAL
+};
+
+enum class _extremum
+{
+  MIN,
+  MAX
+};
+
+// NumPy-style broadcasting: two extents are compatible if they are equal or if
+// either of them is 1. The broadcast operand is always indexed at 1 along that
+// dimension, which is known at compile time and so is hoisted out of the loop.
+template <size_t LeftExtent, size_t RightExtent>
+constexpr bool broadcastable_v =
+    LeftExtent == RightExtent || LeftExtent == 1 || RightExtent == 1;
+
+template <size_t LeftExtent, size_t RightExtent>
+constexpr size_t broadcast_extent_v = LeftExtent == 1 ? RightExtent
+                                                      : LeftExtent;
+
+template <size_t Extent>
+constexpr size_t broadcastIndex(const size_t index)
+{
+  return Extent == 1 ? 1 : index;
+}
+
 template <typename LeftExpr, typename RightExpr>
 struct _matrixElementExpr
   : public _expression<_matrixElementExpr<LeftExpr, RightExpr>>
@@ -203,11 +534,9 @@ struct _matrixElementExpr
   const _operation op;
 
   static_assert(
-      (LeftExprNoRef::rows() == RightExprNoRef::rows()
-       && LeftExprNoRef::cols() == RightExprNoRef::cols())
-          || (LeftExprNoRef::rows() == 1 && LeftExprNoRef::rows() == 1)
-          || (RightExprNoRef::rows() == 1 && RightExprNoRef::cols() == 1),
-      "Matrices must be the same size.");
+      broadcastable_v<LeftExprNoRef::rows(), RightExprNoRef::rows()>
+          && broadcastable_v<LeftExprNoRef::cols(), RightExprNoRef::cols()>,
+      "Matrices must be the same size, or broadcastable to the same size.");
 
   constexpr _matrixElementExpr(LeftExpr left,
                                RightExpr right,
@@ -217,19 +546,27 @@ struct _matrixElementExpr
   }
 
   value_type at(const size_t row, const size_t column) const
-      noexcept  // Will force abort() on exception.
   {
+    // Read through const, so that operands held by reference never go through
+    // a mutable accessor.
+    const auto left =
+        std::as_const(lhs).at(broadcastIndex<LeftExprNoRef::rows()>(row),
+                              broadcastIndex<LeftExprNoRef::cols()>(column));
+    const auto right =
+        std::as_const(rhs).at(broadcastIndex<RightExprNoRef::rows()>(row),
+                              broadcastIndex<RightExprNoRef::cols()>(column));
+
     // TODO: Can this be dispatched statically?
     switch (op)
     {
       case _operation::PLUS:
-        return lhs.at(row, column) + rhs.at(row, column);
+        return left + right;
       case _operation::MINUS:
-        return lhs.at(row, column) - rhs.at(row, column);
+        return left - right;
       case _operation::DOT_PRODUCT:
-        return lhs.at(row, column) * rhs.at(row, column);
+        return left * right;
       case _operation::DOT_DIVIDE:
-        return lhs.at(row, column) / rhs.at(row, column);
+        return left / right;
       default:
         throw std::runtime_error("Unknown operation specified.");
     }
@@ -237,11 +574,192 @@ struct _matrixElementExpr
 
   constexpr static size_t rows()
   {
-    return LeftExprNoRef::rows();
+    return broadcast_extent_v<LeftExprNoRef::rows(), RightExprNoRef::rows()>;
+  }
+  constexpr static size_t cols()
+  {
+    return broadcast_extent_v<LeftExprNoRef::cols(), RightExprNoRef::cols()>;
+  }
+};
+
+template <_comparison Op, typename L, typename R>
+constexpr bool compareValues(const L left, const R right)
+{
+  if constexpr (Op == _comparison::LESS)
+    return left < right;
+  else if constexpr (Op == _comparison::LESS_EQUAL)
+    return left <= right;
+  else if constexpr (Op == _comparison::GREATER)
+    return left > right;
+  else if constexpr (Op == _comparison::GREATER_EQUAL)
+    return left >= right;
+  else if constexpr (Op == _comparison::EQUAL)
+    return left == right;
+  else
+    return left != right;
+}
+
+// Written as a select on a comparison, the way the SIMD min and max
+// instructions behave, so that it vectorises.
+template <_extremum Op, typename T>
+constexpr T extremumOf(const T left, const T right)
+{
+  if constexpr (Op == _extremum::MIN)
+    return right < left ? right : left;
+  else
+    return left < right ? right : left;
+}
+
+// An element-wise comparison, a < b, a == 0, ...: a mask of bools, broadcast
+// like the arithmetic operations. The comparison is part of the type, so a
+// tree of comparisons, min/max and selects compiles to straight-line code.
+template <typename LeftExpr, typename RightExpr, _comparison Op>
+struct _matrixCompareExpr
+  : public _expression<_matrixCompareExpr<LeftExpr, RightExpr, Op>>
+{
+  using LeftExprNoRef  = std::remove_reference_t<LeftExpr>;
+  using RightExprNoRef = std::remove_reference_t<RightExpr>;
+
+  using value_type = bool;
+
+  const LeftExpr lhs;
+  const RightExpr rhs;
+
+  static_assert(
+      broadcastable_v<LeftExprNoRef::rows(), RightExprNoRef::rows()>
+          && broadcastable_v<LeftExprNoRef::cols(), RightExprNoRef::cols()>,
+      "Matrices must be the same size, or broadcastable to the same size.");
+
+  constexpr _matrixCompareExpr(LeftExpr left, RightExpr right)
+    : lhs(left), rhs(right)
+  {
+  }
+
+  bool at(const size_t row, const size_t column) const
+  {
+    return compareValues<Op>(
+        std::as_const(lhs).at(broadcastIndex<LeftExprNoRef::rows()>(row),
+                              broadcastIndex<LeftExprNoRef::cols()>(column)),
+        std::as_const(rhs).at(broadcastIndex<RightExprNoRef::rows()>(row),
+                              broadcastIndex<RightExprNoRef::cols()>(column)));
+  }
+
+  constexpr static size_t rows()
+  {
+    return broadcast_extent_v<LeftExprNoRef::rows(), RightExprNoRef::rows()>;
+  }
+  constexpr static size_t cols()
+  {
+    return broadcast_extent_v<LeftExprNoRef::cols(), RightExprNoRef::cols()>;
+  }
+};
+
+// mat::min(a, b) and mat::max(a, b), broadcast like the arithmetic
+// operations.
+template <typename LeftExpr, typename RightExpr, _extremum Op>
+struct _matrixExtremumExpr
+  : public _expression<_matrixExtremumExpr<LeftExpr, RightExpr, Op>>
+{
+  using LeftExprNoRef  = std::remove_reference_t<LeftExpr>;
+  using RightExprNoRef = std::remove_reference_t<RightExpr>;
+
+  using value_type = std::common_type_t<typename LeftExprNoRef::value_type,
+                                        typename RightExprNoRef::value_type>;
+
+  const LeftExpr lhs;
+  const RightExpr rhs;
+
+  static_assert(
+      broadcastable_v<LeftExprNoRef::rows(), RightExprNoRef::rows()>
+          && broadcastable_v<LeftExprNoRef::cols(), RightExprNoRef::cols()>,
+      "Matrices must be the same size, or broadcastable to the same size.");
+
+  constexpr _matrixExtremumExpr(LeftExpr left, RightExpr right)
+    : lhs(left), rhs(right)
+  {
+  }
+
+  value_type at(const size_t row, const size_t column) const
+  {
+    return extremumOf<Op, value_type>(
+        std::as_const(lhs).at(broadcastIndex<LeftExprNoRef::rows()>(row),
+                              broadcastIndex<LeftExprNoRef::cols()>(column)),
+        std::as_const(rhs).at(broadcastIndex<RightExprNoRef::rows()>(row),
+                              broadcastIndex<RightExprNoRef::cols()>(column)));
+  }
+
+  constexpr static size_t rows()
+  {
+    return broadcast_extent_v<LeftExprNoRef::rows(), RightExprNoRef::rows()>;
+  }
+  constexpr static size_t cols()
+  {
+    return broadcast_extent_v<LeftExprNoRef::cols(), RightExprNoRef::cols()>;
+  }
+};
+
+// mat::where(mask, x, y). Both x and y are read at every element and one of
+// the two values kept, so this is a select rather than a branch, and the
+// mask, x and y fuse with whatever they are built from.
+template <typename MaskExpr, typename TrueExpr, typename FalseExpr>
+struct _matrixSelectExpr
+  : public _expression<_matrixSelectExpr<MaskExpr, TrueExpr, FalseExpr>>
+{
+  using MaskExprNoRef  = std::remove_reference_t<MaskExpr>;
+  using TrueExprNoRef  = std::remove_reference_t<TrueExpr>;
+  using FalseExprNoRef = std::remove_reference_t<FalseExpr>;
+
+  using value_type = std::common_type_t<typename TrueExprNoRef::value_type,
+                                        typename FalseExprNoRef::value_type>;
+
+  const MaskExpr mask;
+  const TrueExpr ifTrue;
+  const FalseExpr ifFalse;
+
+  constexpr static size_t ROWS = broadcast_extent_v<
+      broadcast_extent_v<MaskExprNoRef::rows(), TrueExprNoRef::rows()>,
+      FalseExprNoRef::rows()>;
+  constexpr static size_t COLUMNS = broadcast_extent_v<
+      broadcast_extent_v<MaskExprNoRef::cols(), TrueExprNoRef::cols()>,
+      FalseExprNoRef::cols()>;
+
+  static_assert(
+      broadcastable_v<MaskExprNoRef::rows(), ROWS>
+          && broadcastable_v<TrueExprNoRef::rows(), ROWS>
+          && broadcastable_v<FalseExprNoRef::rows(), ROWS>
+          && broadcastable_v<MaskExprNoRef::cols(), COLUMNS>
+          && broadcastable_v<TrueExprNoRef::cols(), COLUMNS>
+          && broadcastable_v<FalseExprNoRef::cols(), COLUMNS>,
+      "Matrices must be the same size, or broadcastable to the same size.");
+
+  constexpr _matrixSelectExpr(MaskExpr mask_,
+                              TrueExpr ifTrue_,
+                              FalseExpr ifFalse_)
+    : mask(mask_), ifTrue(ifTrue_), ifFalse(ifFalse_)
+  {
+  }
+
+  value_type at(const size_t row, const size_t column) const
+  {
+    const bool selected = std::as_const(mask).at(
+        broadcastIndex<MaskExprNoRef::rows()>(row),
+        broadcastIndex<MaskExprNoRef::cols()>(column));
+    const value_type t = std::as_const(ifTrue).at(
+        broadcastIndex<TrueExprNoRef::rows()>(row),
+        broadcastIndex<TrueExprNoRef::cols()>(column));
+    const value_type f = std::as_const(ifFalse).at(
+        broadcastIndex<FalseExprNoRef::rows()>(row),
+        broadcastIndex<FalseExprNoRef::cols()>(column));
+    return selected ? t : f;
+  }
+
+  constexpr static size_t rows()
+  {
+    return ROWS;
   }
   constexpr static size_t cols()
   {
-    return RightExprNoRef::cols();
+    return COLUMNS;
   }
 };
 
@@ -251,21 +769,23 @@ struct _matrixTranspose : public _expression<_matrixTranspose<MatrixLike>>
   const MatrixLike m_matrix;
 
 public:
+  using value_type = typename std::remove_reference_t<MatrixLike>::value_type;
+
   _matrixTranspose(MatrixLike matrix) : m_matrix(matrix) {}
 
   auto at(size_t i, size_t j) const
   {
-    return m_matrix.at(j, i);
+    return std::as_const(m_matrix).at(j, i);
   }
 
-  static size_t rows()
+  constexpr static size_t rows()
   {
-    return MatrixLike::cols();
+    return std::remove_reference_t<MatrixLike>::cols();
   }
 
-  static size_t cols()
+  constexpr static size_t cols()
   {
-    return MatrixLike::rows();
+    return std::remove_reference_t<MatrixLike>::rows();
   }
 };
 
@@ -273,71 +793,1032 @@ template <typename T>
 _matrixTranspose(T &&val)->_matrixTranspose<T>;
 
 /********************************************************************************
- * Operator overloads - syntactic sugar.
+ * Generators. These hold no storage; every element is computed from its index.
  *******************************************************************************/
-
-// Helper metaprogramming stuff.
-template <typename From, typename To>
-struct rereference
+template <typename T, size_t N>
+struct _matrixIdentity : public _expression<_matrixIdentity<T, N>>
 {
-  using type = To;
+  using value_type = T;
+
+  constexpr T at(const size_t row, const size_t column) const
+  {
+    return row == column ? T(1) : T(0);
+  }
+
+  constexpr static size_t rows()
+  {
+    return N;
+  }
+  constexpr static size_t cols()
+  {
+    return N;
+  }
 };
 
-template <typename From, typename To>
-struct rereference<From &, To>
+template <typename T, size_t Rows, size_t Columns>
+struct _matrixConstant : public _expression<_matrixConstant<T, Rows, Columns>>
 {
-  using type = std::remove_reference_t<To> &;
+  using value_type = T;
+
+  const T value;
+
+  constexpr _matrixConstant(const T v) : value(v) {}
+
+  constexpr T at(const size_t, const size_t) const
+  {
+    return value;
+  }
+
+  constexpr static size_t rows()
+  {
+    return Rows;
+  }
+  constexpr static size_t cols()
+  {
+    return Columns;
+  }
 };
 
-template <typename From, typename To>
-struct rereference<From &&, To>
+// A square matrix with a row or column vector along its diagonal.
+template <typename VectorLike>
+struct _matrixDiagonal : public _expression<_matrixDiagonal<VectorLike>>
 {
-  using type = std::remove_reference_t<To> &&;
-};
+  using VectorNoRef = std::remove_reference_t<VectorLike>;
+  using value_type  = typename VectorNoRef::value_type;
 
-template <typename From, typename To>
-using rereference_t = typename rereference<From, To>::type;
+  static_assert(VectorNoRef::rows() == 1 || VectorNoRef::cols() == 1,
+                "The diagonal must be a row or column vector.");
 
-// Helper to wrap types in the specialisation above if they are an arithmetic
-// type.
-template <typename T>
-using WrapIfIntegral_t = rereference_t<
-    T,
-    std::conditional_t<std::is_arithmetic_v<std::remove_reference_t<T>>,
-                       Matrix<std::remove_reference_t<T>, 1, 1>,
-                       std::remove_reference_t<T>>>;
+  const VectorLike m_vector;
 
-template <typename LeftExpr, typename RightExpr>
-_matrixElementExpr(LeftExpr &&left, RightExpr &&right, const _operation &op_)
-    ->_matrixElementExpr<WrapIfIntegral_t<LeftExpr>,
-                         WrapIfIntegral_t<RightExpr>>;
+  _matrixDiagonal(VectorLike vector) : m_vector(vector) {}
 
-template <typename E1, typename E2>
-constexpr auto operator*(E1 &&left, E2 &&right)
+  value_type at(const size_t row, const size_t column) const
+  {
+    if (row != column)
+      return value_type(0);
+
+    return std::as_const(m_vector).at(
+        broadcastIndex<VectorNoRef::rows()>(row),
+        broadcastIndex<VectorNoRef::cols()>(column));
+  }
+
+  constexpr static size_t rows()
+  {
+    return std::max(VectorNoRef::rows(), VectorNoRef::cols());
+  }
+  constexpr static size_t cols()
+  {
+    return rows();
+  }
+};
+
+template <typename T>
+_matrixDiagonal(T &&val)->_matrixDiagonal<T>;
+
+// lowbias32: a 32-bit integer hash with good avalanche. It is a bijection, and
+// only needs 32-bit multiplies, shifts and xors, which vectorise at every SIMD
+// level.
+constexpr uint32_t hash32(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x7FEB352Du;
+  x ^= x >> 15;
+  x *= 0x846CA68Bu;
+  x ^= x >> 16;
+  return x;
+}
+
+constexpr uint32_t seedKey(const uint64_t seed)
+{
+  return hash32(uint32_t(seed)) ^ hash32(uint32_t(seed >> 32) + 0x9E3779B9u);
+}
+
+// 32 random bits for draw number counter.
+constexpr uint32_t randomBits(const uint32_t key, const uint32_t counter)
+{
+  return hash32(hash32(counter) ^ key);
+}
+
+// Counter-based: element k of a seeded matrix is a hash of (seed, k), so
+// elements are independent and can be generated in any order, or many at once.
+// Everything is done in 32-bit lanes, and converted to floating point from
+// signed 32-bit integers, since that's what every SIMD level can do in bulk.
+// Types wider than 32 bits take two draws per element.
+template <typename T>
+constexpr T randomValue(const uint64_t seed, const uint64_t index)
+{
+  const uint32_t key = seedKey(seed);
+
+  if constexpr (std::is_same_v<T, float>)
+  {
+    // 24 bits, exactly representable: uniform in [0, 1).
+    return float(int32_t(randomBits(key, uint32_t(index)) >> 8)) * 0x1.0p-24f;
+  }
+  else if constexpr (std::is_floating_point_v<T>)
+  {
+    // 26 + 27 bits, as in genrand_res53: exact, and uniform in [0, 1).
+    const uint32_t high = randomBits(key, uint32_t(2 * index)) >> 6;
+    const uint32_t low  = randomBits(key, uint32_t(2 * index + 1)) >> 5;
+    return T(double(int32_t(high)) * 0x1.0p-26
+             + double(int32_t(low)) * 0x1.0p-53);
+  }
+  else if constexpr (sizeof(T) <= sizeof(uint32_t))
+  {
+    return static_cast<T>(randomBits(key, uint32_t(index)));
+  }
+  else
+  {
+    const uint64_t high = randomBits(key, uint32_t(2 * index));
+    const uint64_t low  = randomBits(key, uint32_t(2 * index + 1));
+    return static_cast<T>(high << 32 | low);
+  }
+}
+
+template <typename T, size_t Rows, size_t Columns>
+struct _matrixRandom : public _expression<_matrixRandom<T, Rows, Columns>>
+{
+  using value_type = T;
+
+  const uint64_t seed;
+
+  constexpr _matrixRandom(const uint64_t seed_) : seed(seed_) {}
+
+  constexpr T at(const size_t row, const size_t column) const
+  {
+    return randomValue<T>(seed, (row - 1) * Columns + (column - 1));
+  }
+
+  constexpr static size_t rows()
+  {
+    return Rows;
+  }
+  constexpr static size_t cols()
+  {
+    return Columns;
+  }
+};
+
+// start, start + step, start + 2 * step, ... in row-major order.
+template <typename T, size_t Rows, size_t Columns>
+struct _matrixIota : public _expression<_matrixIota<T, Rows, Columns>>
+{
+  using value_type = T;
+
+  const T start;
+  const T step;
+
+  constexpr _matrixIota(const T start_, const T step_)
+    : start(start_), step(step_)
+  {
+  }
+
+  constexpr T at(const size_t row, const size_t column) const
+  {
+    return start + T((row - 1) * Columns + (column - 1)) * step;
+  }
+
+  constexpr static size_t rows()
+  {
+    return Rows;
+  }
+  constexpr static size_t cols()
+  {
+    return Columns;
+  }
+};
+
+/********************************************************************************
+ * Materialisation kernels, one copy per SIMD level. These work on flat,
+ * row-major storage, so they only apply when the operands are plain matrices,
+ * row or column vectors, or wrapped scalars of the result's type (of any type
+ * in a comparison, min/max or select tree); everything else goes through at().
+ *******************************************************************************/
+// How an operand's flat storage lines up with a Rows x Columns result: the
+// same shape, a single value, a 1 x Columns row repeated down every row, or a
+// Rows x 1 column repeated across every column.
+enum class _broadcast
+{
+  NONE,
+  SCALAR,
+  ROW,
+  COLUMN
+};
+
+template <_broadcast Broadcast, size_t Columns>
+constexpr size_t broadcastOffset(const size_t row, const size_t column)
+{
+  switch (Broadcast)
+  {
+    case _broadcast::SCALAR:
+      return 0;
+    case _broadcast::ROW:
+      return column;
+    case _broadcast::COLUMN:
+      return row;
+    default:
+      return row * Columns + column;
+  }
+}
+
+template <typename T>
+using remove_cvref_t = std::remove_cv_t<std::remove_reference_t<T>>;
+
+// Fused evaluation of a comparison, min/max or select tree, FUSED_BLOCK
+// consecutive elements of a row at a time (of the whole result, with Flat).
+// Each node has a block mirroring it. Leaves point into their storage, at 0
+// along an extent of 1, so scalars, rows and columns broadcast for free.
+// Arithmetic nodes evaluate into a buffer, so that their runtime operation is
+// switched on once per block rather than per element. Comparisons, min/max
+// and selects are computed on the fly, in the loop that writes the result.
+constexpr size_t FUSED_BLOCK = 256;
+
+template <typename E, bool Flat>
+struct _fusedBlock;
+
+// VALUE combines l and r, the elements of each operand.
+#define MAT_FUSED_LOOP(VALUE)        \
+  for (size_t k = 0; k < n; ++k)     \
+  {                                  \
+    const auto l = lhs.at(k);        \
+    const auto r = rhs.at(k);        \
+    values[k]    = VALUE;            \
+  }                                  \
+  break
+
+template <typename T, size_t R, size_t C, bool Flat>
+struct _fusedBlock<Matrix<T, R, C>, Flat>
+{
+  // As bytes for bool; GCC won't vectorise loads of bool next to wider types.
+  using storage_type =
+      std::conditional_t<std::is_same_v<T, bool>, unsigned char, T>;
+
+  // Without Flat, a block lies along a row, so a column is one value in it.
+  constexpr static bool CONSTANT = !Flat && C == 1;
+
+  const storage_type *values;
+
+  MAT_ALWAYS_INLINE void load(const Matrix<T, R, C> &m,
+                              const size_t row,
+                              const size_t column,
+                              size_t)
+  {
+    const auto *data = reinterpret_cast<const storage_type *>(m.data());
+    values           = data
+             + (Flat ? column
+                     : (R == 1 ? 0 : row) * C + (CONSTANT ? 0 : column));
+  }
+
+  MAT_ALWAYS_INLINE T at(const size_t k) const
+  {
+    return T(values[CONSTANT ? 0 : k]);
+  }
+};
+
+template <typename T, bool Flat>
+struct _fusedBlock<Matrix<T, 1, 1>, Flat>
+{
+  T value;
+
+  MAT_ALWAYS_INLINE void load(const Matrix<T, 1, 1> &m, size_t, size_t, size_t)
+  {
+    value = m.value;
+  }
+
+  MAT_ALWAYS_INLINE T at(size_t) const
+  {
+    return value;
+  }
+};
+
+template <typename L, typename R, bool Flat>
+struct _fusedBlock<_matrixElementExpr<L, R>, Flat>
+{
+  using value_type = typename _matrixElementExpr<L, R>::value_type;
+
+  _fusedBlock<remove_cvref_t<L>, Flat> lhs;
+  _fusedBlock<remove_cvref_t<R>, Flat> rhs;
+  value_type values[FUSED_BLOCK];
+
+  MAT_ALWAYS_INLINE void load(const _matrixElementExpr<L, R> &e,
+                              const size_t row,
+                              const size_t column,
+                              const size_t n)
+  {
+    lhs.load(e.lhs, row, column, n);
+    rhs.load(e.rhs, row, column, n);
+
+    switch (e.op)
+    {
+      case _operation::PLUS:
+        MAT_FUSED_LOOP(l + r);
+      case _operation::MINUS:
+        MAT_FUSED_LOOP(l - r);
+      case _operation::DOT_PRODUCT:
+        MAT_FUSED_LOOP(l * r);
+      case _operation::DOT_DIVIDE:
+        MAT_FUSED_LOOP(l / r);
+      default:
+        throw std::runtime_error("Unknown operation specified.");
+    }
+  }
+
+  MAT_ALWAYS_INLINE value_type at(const size_t k) const
+  {
+    return values[k];
+  }
+};
+
+template <typename L, typename R, _comparison Op, bool Flat>
+struct _fusedBlock<_matrixCompareExpr<L, R, Op>, Flat>
+{
+  _fusedBlock<remove_cvref_t<L>, Flat> lhs;
+  _fusedBlock<remove_cvref_t<R>, Flat> rhs;
+
+  MAT_ALWAYS_INLINE void load(const _matrixCompareExpr<L, R, Op> &e,
+                              const size_t row,
+                              const size_t column,
+                              const size_t n)
+  {
+    lhs.load(e.lhs, row, column, n);
+    rhs.load(e.rhs, row, column, n);
+  }
+
+  MAT_ALWAYS_INLINE bool at(const size_t k) const
+  {
+    return compareValues<Op>(lhs.at(k), rhs.at(k));
+  }
+};
+
+template <typename L, typename R, _extremum Op, bool Flat>
+struct _fusedBlock<_matrixExtremumExpr<L, R, Op>, Flat>
+{
+  using value_type = typename _matrixExtremumExpr<L, R, Op>::value_type;
+
+  _fusedBlock<remove_cvref_t<L>, Flat> lhs;
+  _fusedBlock<remove_cvref_t<R>, Flat> rhs;
+
+  MAT_ALWAYS_INLINE void load(const _matrixExtremumExpr<L, R, Op> &e,
+                              const size_t row,
+                              const size_t column,
+                              const size_t n)
+  {
+    lhs.load(e.lhs, row, column, n);
+    rhs.load(e.rhs, row, column, n);
+  }
+
+  MAT_ALWAYS_INLINE value_type at(const size_t k) const
+  {
+    return extremumOf<Op, value_type>(lhs.at(k), rhs.at(k));
+  }
+};
+
+// Both sides are read unconditionally, so this is a blend, not a branch.
+template <typename M, typename X, typename Y, bool Flat>
+struct _fusedBlock<_matrixSelectExpr<M, X, Y>, Flat>
+{
+  using value_type = typename _matrixSelectExpr<M, X, Y>::value_type;
+
+  _fusedBlock<remove_cvref_t<M>, Flat> mask;
+  _fusedBlock<remove_cvref_t<X>, Flat> ifTrue;
+  _fusedBlock<remove_cvref_t<Y>, Flat> ifFalse;
+
+  MAT_ALWAYS_INLINE void load(const _matrixSelectExpr<M, X, Y> &e,
+                              const size_t row,
+                              const size_t column,
+                              const size_t n)
+  {
+    mask.load(e.mask, row, column, n);
+    ifTrue.load(e.ifTrue, row, column, n);
+    ifFalse.load(e.ifFalse, row, column, n);
+  }
+
+  MAT_ALWAYS_INLINE value_type at(const size_t k) const
+  {
+    const bool selected = mask.at(k);
+    const value_type t  = ifTrue.at(k);
+    const value_type f  = ifFalse.at(k);
+    return selected ? t : f;
+  }
+};
+
+// EXPRESSION combines l and r, the elements of each side. A column operand's
+// element is invariant in the inner loop; a row operand is streamed alongside
+// the result, and reused for every row.
+#define MAT_ELEMENTWISE_LOOP(EXPRESSION)                                   \
+  for (size_t i = 0; i < Rows; ++i)                                        \
+    for (size_t j = 0; j < Columns; ++j)                                   \
+    {                                                                      \
+      const auto l = left[broadcastOffset<LeftBroadcast, Columns>(i, j)];  \
+      const auto r = right[broadcastOffset<RightBroadcast, Columns>(i, j)]; \
+      out[i * Columns + j] = EXPRESSION;                                   \
+    }                                                                      \
+  break
+
+#define MAT_DEFINE_KERNELS(NAMESPACE, ATTRIBUTES)                         \
+  namespace NAMESPACE                                                     \
+  {                                                                       \
+  template <size_t Rows,                                                  \
+            size_t Columns,                                               \
+            _broadcast LeftBroadcast,                                     \
+            _broadcast RightBroadcast,                                    \
+            typename T>                                                   \
+  ATTRIBUTES void elementwise(const _operation op,                        \
+                              const T *__restrict left,                   \
+                              const T *__restrict right,                  \
+                              T *__restrict out)                          \
+  {                                                                       \
+    switch (op)                                                           \
+    {                                                                     \
+      case _operation::PLUS:                                              \
+        MAT_ELEMENTWISE_LOOP(l + r);                                      \
+      case _operation::MINUS:                                             \
+        MAT_ELEMENTWISE_LOOP(l - r);                                      \
+      case _operation::DOT_PRODUCT:                                       \
+        MAT_ELEMENTWISE_LOOP(l * r);                                      \
+      case _operation::DOT_DIVIDE:                                        \
+        MAT_ELEMENTWISE_LOOP(l / r);                                      \
+      default:                                                            \
+        throw std::runtime_error("Unknown operation specified.");         \
+    }                                                                     \
+  }                                                                       \
+                                                                          \
+  /* A comparison, min/max or select tree over flat operands, a block  */ \
+  /* at a time; see _fusedBlock.                                        */\
+  template <size_t Rows,                                                  \
+            size_t Columns,                                               \
+            bool Flat,                                                    \
+            typename T,                                                   \
+            typename E>                                                   \
+  ATTRIBUTES void fused(const E &expr, T *__restrict out)                 \
+  {                                                                       \
+    _fusedBlock<E, Flat> block;                                           \
+    for (size_t i = 0; i < Rows; ++i)                                     \
+      for (size_t j = 0; j < Columns; j += FUSED_BLOCK)                   \
+      {                                                                   \
+        const size_t n = std::min(FUSED_BLOCK, Columns - j);              \
+        block.load(expr, i, j, n);                                        \
+                                                                          \
+        T *__restrict row = out + i * Columns + j;                        \
+        for (size_t k = 0; k < n; ++k)                                    \
+        {                                                                 \
+          row[k] = T(block.at(k));                                        \
+        }                                                                 \
+      }                                                                   \
+  }                                                                       \
+                                                                          \
+  /* out is Rows x Columns, in is Columns x Rows. Blocked for locality. */ \
+  template <size_t Rows, size_t Columns, typename T>                      \
+  ATTRIBUTES void transpose(const T *__restrict in, T *__restrict out)    \
+  {                                                                       \
+    constexpr size_t BLOCK = 16;                                          \
+    for (size_t ii = 0; ii < Rows; ii += BLOCK)                           \
+      for (size_t jj = 0; jj < Columns; jj += BLOCK)                      \
+        for (size_t i = ii; i < std::min(ii + BLOCK, Rows); ++i)          \
+          for (size_t j = jj; j < std::min(jj + BLOCK, Columns); ++j)     \
+          {                                                               \
+            out[i * Columns + j] = in[j * Rows + i];                      \
+          }                                                               \
+  }                                                                       \
+                                                                          \
+  /* LANES independent partial sums, so that the loop vectorises without */ \
+  /* reassociating a single floating point sum.                         */ \
+  template <size_t N, typename Accumulator, typename T>                   \
+  ATTRIBUTES Accumulator sum(const T *__restrict in)                      \
+  {                                                                       \
+    constexpr size_t LANES     = 16;                                      \
+    Accumulator partial[LANES] = {};                                      \
+    size_t i                   = 0;                                       \
+    for (; i + LANES <= N; i += LANES)                                    \
+      for (size_t k = 0; k < LANES; ++k)                                  \
+      {                                                                   \
+        partial[k] += Accumulator(in[i + k]);                             \
+      }                                                                   \
+                                                                          \
+    Accumulator total = 0;                                                \
+    for (; i < N; ++i)                                                    \
+    {                                                                     \
+      total += Accumulator(in[i]);                                        \
+    }                                                                     \
+    for (size_t k = 0; k < LANES; ++k)                                    \
+    {                                                                     \
+      total += partial[k];                                                \
+    }                                                                     \
+    return total;                                                         \
+  }                                                                       \
+                                                                          \
+  template <size_t N, typename T>                                         \
+  ATTRIBUTES void random(const uint64_t seed, T *__restrict out)          \
+  {                                                                       \
+    for (size_t i = 0; i < N; ++i)                                        \
+    {                                                                     \
+      out[i] = randomValue<T>(seed, i);                                   \
+    }                                                                     \
+  }                                                                       \
+  }  // end namespace NAMESPACE
+
+namespace simd
+{
+MAT_DEFINE_KERNELS(baseline, )
+#ifdef MAT_SIMD_X86
+MAT_DEFINE_KERNELS(avx2, __attribute__((target("avx2"))))
+MAT_DEFINE_KERNELS(avx512, __attribute__((target("avx512f"))))
+#endif
+
+// Without a row or column operand, the whole result is one flat loop.
+template <size_t Rows,
+          size_t Columns,
+          _broadcast LeftBroadcast,
+          _broadcast RightBroadcast>
+constexpr bool single_loop_v =
+    (LeftBroadcast == _broadcast::NONE || LeftBroadcast == _broadcast::SCALAR)
+    && (RightBroadcast == _broadcast::NONE
+        || RightBroadcast == _broadcast::SCALAR);
+
+template <size_t Rows,
+          size_t Columns,
+          _broadcast LeftBroadcast,
+          _broadcast RightBroadcast,
+          typename T>
+void elementwise(const _operation op, const T *left, const T *right, T *out)
+{
+  constexpr bool single =
+      single_loop_v<Rows, Columns, LeftBroadcast, RightBroadcast>;
+  constexpr size_t R = single ? 1 : Rows;
+  constexpr size_t C = single ? Rows * Columns : Columns;
+
+  switch (simdLevel())
+  {
+#ifdef MAT_SIMD_X86
+    case simd_level::AVX512:
+      return avx512::elementwise<R, C, LeftBroadcast, RightBroadcast>(
+          op, left, right, out);
+    case simd_level::AVX2:
+      return avx2::elementwise<R, C, LeftBroadcast, RightBroadcast>(
+          op, left, right, out);
+#endif
+    default:
+      return baseline::elementwise<R, C, LeftBroadcast, RightBroadcast>(
+          op, left, right, out);
+  }
+}
+
+// Without a row or column leaf, the whole tree is one flat loop.
+template <size_t Rows, size_t Columns, bool Broadcasts, typename T, typename E>
+void fused(const E &expr, T *out)
+{
+  constexpr bool flat = !Broadcasts;
+  constexpr size_t R  = flat ? 1 : Rows;
+  constexpr size_t C  = flat ? Rows * Columns : Columns;
+
+  switch (simdLevel())
+  {
+#ifdef MAT_SIMD_X86
+    case simd_level::AVX512:
+      return avx512::fused<R, C, flat>(expr, out);
+    case simd_level::AVX2:
+      return avx2::fused<R, C, flat>(expr, out);
+#endif
+    default:
+      return baseline::fused<R, C, flat>(expr, out);
+  }
+}
+
+template <size_t Rows, size_t Columns, typename T>
+void transpose(const T *in, T *out)
+{
+  switch (simdLevel())
+  {
+#ifdef MAT_SIMD_X86
+    case simd_level::AVX512:
+      return avx512::transpose<Rows, Columns>(in, out);
+    case simd_level::AVX2:
+      return avx2::transpose<Rows, Columns>(in, out);
+#endif
+    default:
+      return baseline::transpose<Rows, Columns>(in, out);
+  }
+}
+
+template <size_t N, typename Accumulator, typename T>
+Accumulator sum(const T *in)
+{
+  switch (simdLevel())
+  {
+#ifdef MAT_SIMD_X86
+    case simd_level::AVX512:
+      return avx512::sum<N, Accumulator>(in);
+    case simd_level::AVX2:
+      return avx2::sum<N, Accumulator>(in);
+#endif
+    default:
+      return baseline::sum<N, Accumulator>(in);
+  }
+}
+
+template <size_t N, typename T>
+void random(const uint64_t seed, T *out)
+{
+  switch (simdLevel())
+  {
+#ifdef MAT_SIMD_X86
+    case simd_level::AVX512:
+      return avx512::random<N>(seed, out);
+    case simd_level::AVX2:
+      return avx2::random<N>(seed, out);
+#endif
+    default:
+      return baseline::random<N>(seed, out);
+  }
+}
+}  // end namespace simd
+
+#undef MAT_DEFINE_KERNELS
+#undef MAT_ELEMENTWISE_LOOP
+#undef MAT_FUSED_LOOP
+
+template <typename E>
+constexpr bool is_element_expr_v = false;
+
+template <typename L, typename R>
+constexpr bool is_element_expr_v<_matrixElementExpr<L, R>> = true;
+
+// Whether an operand can be read straight from flat storage by the kernels.
+template <typename Operand, typename T, size_t Rows, size_t Columns>
+constexpr bool is_flat_matrix_v =
+    std::is_same_v<remove_cvref_t<Operand>, Matrix<T, Rows, Columns>>;
+
+template <typename Operand, typename T>
+constexpr bool is_flat_scalar_v =
+    std::is_same_v<remove_cvref_t<Operand>, Matrix<T, 1, 1>>;
+
+// Whether an operand can be read from flat storage, possibly broadcast, into
+// a Rows x Columns result.
+template <typename Operand, typename T, size_t Rows, size_t Columns>
+constexpr bool is_flat_operand_v =
+    is_flat_matrix_v<Operand, T, Rows, Columns> || is_flat_scalar_v<Operand, T>
+    || is_flat_matrix_v<Operand, T, 1, Columns>
+    || is_flat_matrix_v<Operand, T, Rows, 1>;
+
+template <typename Operand, typename T, size_t Rows, size_t Columns>
+constexpr _broadcast broadcast_of_v =
+    is_flat_scalar_v<Operand, T> ? _broadcast::SCALAR
+    : is_flat_matrix_v<Operand, T, Rows, Columns> ? _broadcast::NONE
+    : is_flat_matrix_v<Operand, T, 1, Columns>    ? _broadcast::ROW
+                                                  : _broadcast::COLUMN;
+
+template <typename T, size_t Rows, size_t Columns>
+const T *flatData(const Matrix<T, Rows, Columns> &m)
+{
+  return m.data();
+}
+
+template <typename T>
+const T *flatData(const Matrix<T, 1, 1> &m)
+{
+  return &m.value;
+}
+
+struct _noKernel
 {
-  return _matrixElementExpr(
+  constexpr static bool elementwise = false;
+  constexpr static bool fused       = false;
+  constexpr static bool transpose   = false;
+  constexpr static bool random      = false;
+};
+
+template <typename E, typename T, size_t Rows, size_t Columns>
+struct _kernelFor : _noKernel
+{
+};
+
+template <typename L, typename R, typename T, size_t Rows, size_t Columns>
+struct _kernelFor<_matrixElementExpr<L, R>, T, Rows, Columns> : _noKernel
+{
+  constexpr static _broadcast leftBroadcast =
+      broadcast_of_v<L, T, Rows, Columns>;
+  constexpr static _broadcast rightBroadcast =
+      broadcast_of_v<R, T, Rows, Columns>;
+
+  constexpr static bool elementwise = is_flat_operand_v<L, T, Rows, Columns>
+                                      && is_flat_operand_v<R, T, Rows, Columns>;
+};
+
+// Whether a comparison, min/max or select tree, with any arithmetic in it, can
+// be evaluated by the fused kernel, and whether any of its leaves is a row or
+// a column that has to be broadcast across a Rows x Columns result.
+template <typename E, size_t Rows, size_t Columns>
+struct _fusion
+{
+  constexpr static bool fusable    = false;
+  constexpr static bool broadcasts = false;
+};
+
+template <typename T, size_t R, size_t C, size_t Rows, size_t Columns>
+struct _fusion<Matrix<T, R, C>, Rows, Columns>
+{
+  constexpr static bool fusable = true;
+  constexpr static bool broadcasts =
+      !(R == Rows && C == Columns) && !(R == 1 && C == 1);
+};
+
+template <size_t Rows, size_t Columns, typename... Operands>
+struct _fusionOf
+{
+  constexpr static bool fusable =
+      (_fusion<remove_cvref_t<Operands>, Rows, Columns>::fusable && ...);
+  constexpr static bool broadcasts =
+      (_fusion<remove_cvref_t<Operands>, Rows, Columns>::broadcasts || ...);
+};
+
+template <typename L, typename R, size_t Rows, size_t Columns>
+struct _fusion<_matrixElementExpr<L, R>, Rows, Columns>
+  : _fusionOf<Rows, Columns, L, R>
+{
+};
+
+template <typename L, typename R, _comparison Op, size_t Rows, size_t Columns>
+struct _fusion<_matrixCompareExpr<L, R, Op>, Rows, Columns>
+  : _fusionOf<Rows, Columns, L, R>
+{
+};
+
+template <typename L, typename R, _extremum Op, size_t Rows, size_t Columns>
+struct _fusion<_matrixExtremumExpr<L, R, Op>, Rows, Columns>
+  : _fusionOf<Rows, Columns, L, R>
+{
+};
+
+template <typename M, typename X, typename Y, size_t Rows, size_t Columns>
+struct _fusion<_matrixSelectExpr<M, X, Y>, Rows, Columns>
+  : _fusionOf<Rows, Columns, M, X, Y>
+{
+};
+
+template <typename L, typename R, _comparison Op, size_t Rows, size_t Columns>
+struct _kernelFor<_matrixCompareExpr<L, R, Op>, bool, Rows, Columns>
+  : _noKernel
+{
+  using fusion = _fusion<_matrixCompareExpr<L, R, Op>, Rows, Columns>;
+
+  constexpr static bool fused = fusion::fusable;
+};
+
+template <typename L,
+          typename R,
+          _extremum Op,
+          typename T,
+          size_t Rows,
+          size_t Columns>
+struct _kernelFor<_matrixExtremumExpr<L, R, Op>, T, Rows, Columns> : _noKernel
+{
+  using fusion = _fusion<_matrixExtremumExpr<L, R, Op>, Rows, Columns>;
+
+  constexpr static bool fused = fusion::fusable;
+};
+
+template <typename M,
+          typename X,
+          typename Y,
+          typename T,
+          size_t Rows,
+          size_t Columns>
+struct _kernelFor<_matrixSelectExpr<M, X, Y>, T, Rows, Columns> : _noKernel
+{
+  using fusion = _fusion<_matrixSelectExpr<M, X, Y>, Rows, Columns>;
+
+  constexpr static bool fused = fusion::fusable;
+};
+
+template <typename M, typename T, size_t Rows, size_t Columns>
+struct _kernelFor<_matrixTranspose<M>, T, Rows, Columns> : _noKernel
+{
+  constexpr static bool transpose = is_flat_matrix_v<M, T, Columns, Rows>;
+};
+
+template <typename T, size_t Rows, size_t Columns>
+struct _kernelFor<_matrixRandom<T, Rows, Columns>, T, Rows, Columns>
+  : _noKernel
+{
+  constexpr static bool random = true;
+};
+
+template <typename T, size_t Rows, size_t Columns, typename E>
+void _evaluate(T *out, const E &expr)
+{
+  using kernel = _kernelFor<E, T, Rows, Columns>;
+
+#ifdef MAT_INSTRUMENTATION
+  instrumentation::detail::_materialisationScope<E> scope(
+      Rows * Columns, Rows * Columns * sizeof(T));
+#endif
+
+  if constexpr (kernel::elementwise)
+  {
+    simd::elementwise<Rows,
+                      Columns,
+                      kernel::leftBroadcast,
+                      kernel::rightBroadcast>(
+        expr.op, flatData(expr.lhs), flatData(expr.rhs), out);
+  }
+  else if constexpr (kernel::fused)
+  {
+    simd::fused<Rows, Columns, kernel::fusion::broadcasts>(expr, out);
+  }
+  else if constexpr (kernel::transpose)
+  {
+    simd::transpose<Rows, Columns>(expr.m_matrix.data(), out);
+  }
+  else if constexpr (kernel::random)
+  {
+    simd::random<Rows * Columns>(expr.seed, out);
+  }
+  else
+  {
+    for (size_t i = 1; i <= Rows; ++i)
+      for (size_t j = 1; j <= Columns; ++j)
+      {
+        *out++ = expr.at(i, j);
+      }
+  }
+}
+
+/********************************************************************************
+ * Operator overloads - syntactic sugar.
+ *******************************************************************************/
+
+// Helper metaprogramming stuff.
+template <typename From, typename To>
+struct rereference
+{
+  using type = To;
+};
+
+template <typename From, typename To>
+struct rereference<From &, To>
+{
+  using type = std::remove_reference_t<To> &;
+};
+
+template <typename From, typename To>
+struct rereference<From &&, To>
+{
+  using type = std::remove_reference_t<To> &&;
+};
+
+template <typename From, typename To>
+using rereference_t = typename rereference<From, To>::type;
+
+// Helper to wrap types in the specialisation above if they are an arithmetic
+// type. Equivalent to rereference_t<T, Matrix<remove_reference_t<T>, 1, 1>> for
+// arithmetic T, and T otherwise, but resolved with a single specialisation
+// since it's instantiated for every operand of every operator.
+template <typename T, bool = std::is_arithmetic_v<std::remove_reference_t<T>>>
+struct WrapIfIntegral
+{
+  using type = T;
+};
+
+template <typename T>
+struct WrapIfIntegral<T, true>
+{
+  using type = Matrix<T, 1, 1>;
+};
+
+template <typename T>
+struct WrapIfIntegral<T &, true>
+{
+  using type = Matrix<T, 1, 1> &;
+};
+
+template <typename T>
+struct WrapIfIntegral<T &&, true>
+{
+  using type = Matrix<T, 1, 1> &&;
+};
+
+template <typename T>
+using WrapIfIntegral_t = typename WrapIfIntegral<T>::type;
+
+// As WrapIfIntegral_t, but a scalar is always wrapped by value, so that it can
+// be a variable: a < threshold, mat::clamp(x, low, high).
+template <typename T>
+using WrapScalar_t =
+    WrapIfIntegral_t<std::conditional_t<std::is_arithmetic_v<remove_cvref_t<T>>,
+                                        remove_cvref_t<T>,
+                                        T>>;
+
+template <typename LeftExpr, typename RightExpr>
+_matrixElementExpr(LeftExpr &&left, RightExpr &&right, const _operation &op_)
+    ->_matrixElementExpr<WrapIfIntegral_t<LeftExpr>,
+                         WrapIfIntegral_t<RightExpr>>;
+
+// The operators name the expression type directly rather than going through
+// the deduction guide above, which is much cheaper to compile.
+
+template <typename E1, typename E2>
+constexpr auto operator*(E1 &&left, E2 &&right)
+{
+  return _matrixElementExpr<WrapIfIntegral_t<E1>, WrapIfIntegral_t<E2>>(
       std::forward<E1>(left), std::forward<E2>(right), _operation::DOT_PRODUCT);
 }
 
 template <typename E1, typename E2>
 constexpr auto operator+(E1 &&left, E2 &&right)
 {
-  return _matrixElementExpr(
+  return _matrixElementExpr<WrapIfIntegral_t<E1>, WrapIfIntegral_t<E2>>(
       std::forward<E1>(left), std::forward<E2>(right), _operation::PLUS);
 }
 template <typename E1, typename E2>
 constexpr auto operator-(E1 &&left, E2 &&right)
 {
-  return _matrixElementExpr(
+  return _matrixElementExpr<WrapIfIntegral_t<E1>, WrapIfIntegral_t<E2>>(
       std::forward<E1>(left), std::forward<E2>(right), _operation::MINUS);
 }
 template <typename E1, typename E2>
 constexpr auto operator/(E1 &&left, E2 &&right)
 {
-  return _matrixElementExpr(
+  return _matrixElementExpr<WrapIfIntegral_t<E1>, WrapIfIntegral_t<E2>>(
       std::forward<E1>(left), std::forward<E2>(right), _operation::DOT_DIVIDE);
 }
 
+// Comparisons would otherwise be picked up for anything in this namespace, so
+// they only apply when at least one side is an expression and the other is an
+// expression or a scalar.
+template <typename E>
+std::true_type _isExpression(const _expression<E> &);
+std::false_type _isExpression(...);
+
+template <typename T>
+constexpr bool is_expression_v =
+    decltype(_isExpression(std::declval<const remove_cvref_t<T> &>()))::value;
+
+template <typename T>
+constexpr bool is_wrapped_scalar_v = false;
+
+template <typename T>
+constexpr bool is_wrapped_scalar_v<Matrix<T, 1, 1>> = true;
+
+// A Matrix<T, 1, 1> converts to its value, so comparing it against a scalar
+// or another wrapper stays a plain comparison giving a bool. It only becomes
+// a mask when the other side is a real expression.
+template <typename T>
+constexpr bool is_mask_operand_v =
+    is_expression_v<T> && !is_wrapped_scalar_v<remove_cvref_t<T>>;
+
+template <typename E1, typename E2>
+constexpr bool comparable_v =
+    (is_mask_operand_v<E1> || is_mask_operand_v<E2>)
+    && (is_expression_v<E1> || std::is_arithmetic_v<remove_cvref_t<E1>>)
+    && (is_expression_v<E2> || std::is_arithmetic_v<remove_cvref_t<E2>>);
+
+template <typename E1, typename E2>
+using enable_if_comparable_t = std::enable_if_t<comparable_v<E1, E2>, int>;
+
+template <_comparison Op, typename E1, typename E2>
+constexpr auto _compare(E1 &&left, E2 &&right)
+{
+  return _matrixCompareExpr<WrapScalar_t<E1>, WrapScalar_t<E2>, Op>(
+      std::forward<E1>(left), std::forward<E2>(right));
+}
+
+template <typename E1, typename E2, enable_if_comparable_t<E1, E2> = 0>
+constexpr auto operator<(E1 &&left, E2 &&right)
+{
+  return _compare<_comparison::LESS>(std::forward<E1>(left),
+                                     std::forward<E2>(right));
+}
+template <typename E1, typename E2, enable_if_comparable_t<E1, E2> = 0>
+constexpr auto operator<=(E1 &&left, E2 &&right)
+{
+  return _compare<_comparison::LESS_EQUAL>(std::forward<E1>(left),
+                                           std::forward<E2>(right));
+}
+template <typename E1, typename E2, enable_if_comparable_t<E1, E2> = 0>
+constexpr auto operator>(E1 &&left, E2 &&right)
+{
+  return _compare<_comparison::GREATER>(std::forward<E1>(left),
+                                        std::forward<E2>(right));
+}
+template <typename E1, typename E2, enable_if_comparable_t<E1, E2> = 0>
+constexpr auto operator>=(E1 &&left, E2 &&right)
+{
+  return _compare<_comparison::GREATER_EQUAL>(std::forward<E1>(left),
+                                              std::forward<E2>(right));
+}
+template <typename E1, typename E2, enable_if_comparable_t<E1, E2> = 0>
+constexpr auto operator==(E1 &&left, E2 &&right)
+{
+  return _compare<_comparison::EQUAL>(std::forward<E1>(left),
+                                      std::forward<E2>(right));
+}
+template <typename E1, typename E2, enable_if_comparable_t<E1, E2> = 0>
+constexpr auto operator!=(E1 &&left, E2 &&right)
+{
+  return _compare<_comparison::NOT_EQUAL>(std::forward<E1>(left),
+                                          std::forward<E2>(right));
+}
+
 }  // end namespace detail
 
 template <typename E>
@@ -346,6 +1827,154 @@ constexpr auto transpose(E &&expr)
   return detail::_matrixTranspose(std::forward<E>(expr));
 }
 
+template <typename T, size_t N>
+constexpr auto identity()
+{
+  return detail::_matrixIdentity<T, N>();
+}
+
+template <typename T, size_t Rows, size_t Columns>
+constexpr auto constant(const T value)
+{
+  return detail::_matrixConstant<T, Rows, Columns>(value);
+}
+
+template <typename E>
+constexpr auto diagonal(E &&vector)
+{
+  return detail::_matrixDiagonal(std::forward<E>(vector));
+}
+
+template <typename T, size_t Rows, size_t Columns>
+constexpr auto iota(const T start = T(0), const T step = T(1))
+{
+  return detail::_matrixIota<T, Rows, Columns>(start, step);
+}
+
+// Integers cover their whole range; floating point values are in [0, 1).
+template <typename T, size_t Rows, size_t Columns>
+constexpr auto random(const uint64_t seed)
+{
+  return detail::_matrixRandom<T, Rows, Columns>(seed);
+}
+
+// Element-wise mask ? ifTrue : ifFalse, where mask is typically a comparison:
+//   auto relu = mat::where(x > 0, x, 0);
+// Any of the three may be a scalar, or broadcast.
+template <typename M, typename X, typename Y>
+constexpr auto where(M &&mask, X &&ifTrue, Y &&ifFalse)
+{
+  return detail::_matrixSelectExpr<detail::WrapScalar_t<M>,
+                                   detail::WrapScalar_t<X>,
+                                   detail::WrapScalar_t<Y>>(
+      std::forward<M>(mask),
+      std::forward<X>(ifTrue),
+      std::forward<Y>(ifFalse));
+}
+
+template <typename E1, typename E2>
+constexpr auto min(E1 &&left, E2 &&right)
+{
+  return detail::_matrixExtremumExpr<detail::WrapScalar_t<E1>,
+                                     detail::WrapScalar_t<E2>,
+                                     detail::_extremum::MIN>(
+      std::forward<E1>(left), std::forward<E2>(right));
+}
+
+template <typename E1, typename E2>
+constexpr auto max(E1 &&left, E2 &&right)
+{
+  return detail::_matrixExtremumExpr<detail::WrapScalar_t<E1>,
+                                     detail::WrapScalar_t<E2>,
+                                     detail::_extremum::MAX>(
+      std::forward<E1>(left), std::forward<E2>(right));
+}
+
+// min(max(expr, low), high); the bounds may be scalars or broadcast.
+template <typename E, typename Low, typename High>
+constexpr auto clamp(E &&expr, Low &&low, High &&high)
+{
+  return mat::min(mat::max(std::forward<E>(expr), std::forward<Low>(low)),
+                  std::forward<High>(high));
+}
+
+// Sums every element of an expression, accumulating in its value_type.
+template <typename E>
+auto sum(const detail::_expression<E> &expr)
+{
+  typename E::value_type total = 0;
+  for (size_t i = 1; i <= E::rows(); ++i)
+    for (size_t j = 1; j <= E::cols(); ++j)
+    {
+      total += static_cast<const E &>(expr).at(i, j);
+    }
+  return total;
+}
+
+// A stored matrix is summed straight from its storage, by a SIMD kernel.
+template <typename T, size_t Rows, size_t Columns>
+T sum(const Matrix<T, Rows, Columns> &matrix)
+{
+  return detail::simd::sum<Rows * Columns, T>(detail::flatData(matrix));
+}
+
+namespace detail
+{
+template <typename Targets, typename Expressions, size_t... I>
+void _assignAll(Targets &targets,
+                const Expressions &exprs,
+                std::index_sequence<I...>)
+{
+  using first = remove_cvref_t<std::tuple_element_t<0, Targets>>;
+
+#ifdef MAT_INSTRUMENTATION
+  instrumentation::detail::_materialisationScope<Expressions> scope(
+      sizeof...(I) * first::rows() * first::cols(),
+      (sizeof(typename remove_cvref_t<std::tuple_element_t<I, Targets>>::
+                  value_type)
+       + ...)
+          * first::rows() * first::cols());
+#endif
+
+  size_t index = 0;
+  for (size_t i = 1; i <= first::rows(); ++i)
+    for (size_t j = 1; j <= first::cols(); ++j, ++index)
+    {
+      ((std::get<I>(targets).data()[index] = std::get<I>(exprs).at(i, j)),
+       ...);
+    }
+}
+}  // end namespace detail
+
+// Evaluates several same-shape expressions in a single sweep, so that inputs
+// shared between them are only streamed through memory once:
+//   mat::assign_all(std::tie(r, s, t), a + b, a - b, a * b);
+// Elements are assigned in order at each position, so an expression may read
+// an earlier target element-wise, but must not transpose one.
+template <typename... Matrices, typename... Expressions>
+void assign_all(std::tuple<Matrices &...> targets,
+                const Expressions &... exprs)
+{
+  static_assert(sizeof...(Matrices) == sizeof...(Expressions),
+                "Need exactly one expression per target.");
+  static_assert(sizeof...(Matrices) > 0, "Nothing to assign.");
+  static_assert(((Matrices::rows() == Expressions::rows()
+                  && Matrices::cols() == Expressions::cols())
+                 && ...),
+                "Each expression must be the same size as its target.");
+  static_assert(
+      ((Matrices::rows() == std::tuple_element_t<0, std::tuple<Matrices...>>::
+                                rows()
+        && Matrices::cols()
+               == std::tuple_element_t<0, std::tuple<Matrices...>>::cols())
+       && ...),
+      "All targets must be the same size.");
+
+  detail::_assignAll(targets,
+                     std::forward_as_tuple(exprs...),
+                     std::index_sequence_for<Matrices...>{});
+}
+
 }  // end namespace mat
 
 #endif  // Header guard.
@@ -0,0 +1,285 @@
+#pragma once
+#ifndef JUMBATM_QUANTIZED_MATRIX_HPP_INCLUDED  // Begin Header guard.
+#define JUMBATM_QUANTIZED_MATRIX_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "Matrix.hpp"
+
+namespace mat
+{
+namespace detail
+{
+// The type quantized values are widened to before any arithmetic. It is wide
+// enough that a product of two centred values can't overflow.
+template <typename T>
+struct accumulator
+{
+  static_assert(std::is_integral_v<T> && sizeof(T) <= 2,
+                "Quantized matrices hold 8 or 16 bit integers.");
+  using type = std::conditional_t<sizeof(T) == 1, int32_t, int64_t>;
+};
+
+template <typename T>
+using accumulator_t = typename accumulator<T>::type;
+
+/********************************************************************************
+ * Quantisation nodes.
+ *******************************************************************************/
+
+// Maps each element x of an expression to the quantized value
+//   clamp(round(x * multiplier) + zeroPoint),
+// and remembers the scale the result is in. Quantising real values uses a
+// multiplier of 1 / scale; requantising an accumulator uses
+// inputScale / outputScale.
+template <typename E, typename T>
+struct _matrixRequantize : public _expression<_matrixRequantize<E, T>>
+{
+  using ExprNoRef  = std::remove_reference_t<E>;
+  using value_type = T;
+
+  const E m_expr;
+  const double m_multiplier;
+  const float m_scale;
+  const int32_t m_zeroPoint;
+
+  _matrixRequantize(E expr,
+                    const double multiplier,
+                    const float scale,
+                    const int32_t zeroPoint)
+    : m_expr(expr)
+    , m_multiplier(multiplier)
+    , m_scale(scale)
+    , m_zeroPoint(zeroPoint)
+  {
+  }
+
+  T at(const size_t row, const size_t column) const
+  {
+    const double value =
+        std::nearbyint(std::as_const(m_expr).at(row, column) * m_multiplier)
+        + m_zeroPoint;
+    return static_cast<T>(
+        std::clamp(value,
+                   static_cast<double>(std::numeric_limits<T>::min()),
+                   static_cast<double>(std::numeric_limits<T>::max())));
+  }
+
+  constexpr static size_t rows()
+  {
+    return ExprNoRef::rows();
+  }
+  constexpr static size_t cols()
+  {
+    return ExprNoRef::cols();
+  }
+};
+
+// Maps each element of an expression of centred, quantized values back to a
+// real value, scale * x.
+template <typename E, typename Real>
+struct _matrixDequantize : public _expression<_matrixDequantize<E, Real>>
+{
+  using ExprNoRef  = std::remove_reference_t<E>;
+  using value_type = Real;
+
+  const E m_expr;
+  const Real m_scale;
+
+  _matrixDequantize(E expr, const Real scale) : m_expr(expr), m_scale(scale) {}
+
+  Real at(const size_t row, const size_t column) const
+  {
+    return m_scale * static_cast<Real>(std::as_const(m_expr).at(row, column));
+  }
+
+  constexpr static size_t rows()
+  {
+    return ExprNoRef::rows();
+  }
+  constexpr static size_t cols()
+  {
+    return ExprNoRef::cols();
+  }
+};
+}  // end namespace detail
+
+/********************************************************************************
+ * A matrix of 8 or 16 bit integers q, representing the real values
+ *   scale * (q - zeroPoint).
+ *
+ * As an expression, it yields the centred values q - zeroPoint, widened to
+ * accumulator_t<T>. So arithmetic between quantized matrices is done in int32
+ * (int64 for 16 bit values) rather than in whatever the integers promote to,
+ * and the scale of the result is the caller's to track, e.g.
+ *   mat::dequantize(a * b, a.scale() * b.scale());
+ *******************************************************************************/
+template <typename T, size_t Rows, size_t Columns>
+class QuantizedMatrix
+  : public detail::_expression<QuantizedMatrix<T, Rows, Columns>>
+{
+  std::array<T, Rows * Columns> m_data = {};
+
+  float m_scale       = 1.0f;
+  int32_t m_zeroPoint = 0;
+
+  /*******************************************************************************
+   * Constructors.
+   ******************************************************************************/
+public:
+  explicit QuantizedMatrix(const float scale       = 1.0f,
+                           const int32_t zeroPoint = 0)
+    : m_scale(scale), m_zeroPoint(zeroPoint)
+  {
+    m_data.fill(static_cast<T>(zeroPoint));
+  }
+  QuantizedMatrix(QuantizedMatrix &&)      = default;
+  QuantizedMatrix(const QuantizedMatrix &) = default;
+
+  // Construct from mat::quantize() or mat::requantize(), taking on their scale
+  // and zero point.
+  template <typename E>
+  QuantizedMatrix(const detail::_matrixRequantize<E, T> &expr)
+    : m_scale(expr.m_scale), m_zeroPoint(expr.m_zeroPoint)
+  {
+    static_assert(
+        std::remove_reference_t<E>::rows() == Rows
+            && std::remove_reference_t<E>::cols() == Columns,
+        "Expression does not evaluate to a matrix of this size.");
+    detail::_evaluate<T, Rows, Columns>(m_data.data(), expr);
+  }
+
+  /*******************************************************************************
+   * Public interface
+   ******************************************************************************/
+public:
+  constexpr inline static size_t convertToFlatIndex(const size_t rowIndex,
+                                                    const size_t columnIndex)
+  {
+    EXCEPT_ASSERT((0 < rowIndex && rowIndex <= Rows)
+                  && (0 < columnIndex && columnIndex <= Columns));
+    return (rowIndex - 1) * Columns + (columnIndex - 1);
+  }
+
+  // The stored, quantized value.
+  T &raw(const size_t rowIndex, const size_t columnIndex)
+  {
+    return m_data.at(convertToFlatIndex(rowIndex, columnIndex));
+  }
+
+  T raw(const size_t rowIndex, const size_t columnIndex) const
+  {
+    return m_data.at(convertToFlatIndex(rowIndex, columnIndex));
+  }
+
+  // The centred value, q - zeroPoint.
+  detail::accumulator_t<T> at(const size_t rowIndex,
+                              const size_t columnIndex) const
+  {
+    return static_cast<detail::accumulator_t<T>>(raw(rowIndex, columnIndex))
+           - m_zeroPoint;
+  }
+
+  float scale() const
+  {
+    return m_scale;
+  }
+  int32_t zeroPoint() const
+  {
+    return m_zeroPoint;
+  }
+
+  constexpr static size_t rows()
+  {
+    return Rows;
+  }
+  constexpr static size_t cols()
+  {
+    return Columns;
+  }
+  /*******************************************************************************
+   * Ranged for-loop / iterator support, over the stored values.
+   ******************************************************************************/
+  auto begin()
+  {
+    return m_data.begin();
+  }
+  auto end()
+  {
+    return m_data.end();
+  }
+  /*******************************************************************************
+   * Raw row-major storage, for kernels.
+   ******************************************************************************/
+  T *data()
+  {
+    return m_data.data();
+  }
+  const T *data() const
+  {
+    return m_data.data();
+  }
+  /*******************************************************************************
+   * Convenience typedefs.
+   ******************************************************************************/
+  using value_type = detail::accumulator_t<T>;
+
+};  // end template class QuantizedMatrix
+
+// Quantizes a real-valued expression:
+//   QuantizedMatrix<int8_t, 3, 3> q = mat::quantize<int8_t>(x, 0.05f, 0);
+template <typename T, typename E>
+auto quantize(E &&expr, const float scale, const int32_t zeroPoint)
+{
+  return detail::_matrixRequantize<E, T>(
+      std::forward<E>(expr), 1.0 / scale, scale, zeroPoint);
+}
+
+// Requantizes an expression of accumulated values in inputScale, e.g. a
+// product of two quantized matrices, without going through floating point
+// storage.
+template <typename T, typename E>
+auto requantize(E &&expr,
+                const float inputScale,
+                const float outputScale,
+                const int32_t outputZeroPoint)
+{
+  return detail::_matrixRequantize<E, T>(std::forward<E>(expr),
+                                         double(inputScale) / outputScale,
+                                         outputScale,
+                                         outputZeroPoint);
+}
+
+// Sums the centred values, q - zeroPoint, in the accumulator type, straight
+// from the stored values.
+template <typename T, size_t Rows, size_t Columns>
+detail::accumulator_t<T> sum(const QuantizedMatrix<T, Rows, Columns> &matrix)
+{
+  using accumulator = detail::accumulator_t<T>;
+  return detail::simd::sum<Rows * Columns, accumulator>(matrix.data())
+         - accumulator(Rows * Columns) * matrix.zeroPoint();
+}
+
+template <typename Real = float, typename E>
+auto dequantize(E &&expr, const Real scale)
+{
+  return detail::_matrixDequantize<E, Real>(std::forward<E>(expr), scale);
+}
+
+template <typename Real = float, typename T, size_t Rows, size_t Columns>
+auto dequantize(const QuantizedMatrix<T, Rows, Columns> &matrix)
+{
+  return detail::_matrixDequantize<const QuantizedMatrix<T, Rows, Columns> &,
+                                   Real>(matrix, Real(matrix.scale()));
+}
+
+}  // end namespace mat
+
+#endif  // Header guard.
@@ -0,0 +1,268 @@
+#pragma once
+#ifndef JUMBATM_STRUCTURED_MATRIX_HPP_INCLUDED  // Begin Header guard.
+#define JUMBATM_STRUCTURED_MATRIX_HPP_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "Matrix.hpp"
+
+namespace mat
+{
+enum class triangle
+{
+  UPPER,
+  LOWER
+};
+
+namespace detail
+{
+/********************************************************************************
+ * Packings. Each describes which elements of an N x N matrix are stored, as a
+ * contiguous range of columns [first(i), last(i)] for every row i, and where
+ * row i starts in the packed, row-major storage.
+ *******************************************************************************/
+template <size_t N>
+struct _upperPacking
+{
+  constexpr static size_t size = N * (N + 1) / 2;
+
+  constexpr static size_t first(const size_t row)
+  {
+    return row;
+  }
+  constexpr static size_t last(const size_t)
+  {
+    return N;
+  }
+  constexpr static size_t offset(const size_t row)
+  {
+    return (row - 1) * N - (row - 1) * (row - 2) / 2;
+  }
+};
+
+template <size_t N>
+struct _lowerPacking
+{
+  constexpr static size_t size = N * (N + 1) / 2;
+
+  constexpr static size_t first(const size_t)
+  {
+    return 1;
+  }
+  constexpr static size_t last(const size_t row)
+  {
+    return row;
+  }
+  constexpr static size_t offset(const size_t row)
+  {
+    return row * (row - 1) / 2;
+  }
+};
+
+template <size_t N>
+struct _diagonalPacking
+{
+  constexpr static size_t size = N;
+
+  constexpr static size_t first(const size_t row)
+  {
+    return row;
+  }
+  constexpr static size_t last(const size_t row)
+  {
+    return row;
+  }
+  constexpr static size_t offset(const size_t row)
+  {
+    return row - 1;
+  }
+};
+
+// An N x N matrix that only stores the elements its Packing describes. If
+// Mirrored, element (i, j) outside the packing is read from (j, i); otherwise
+// it is a known zero.
+template <typename T, size_t N, typename Packing, bool Mirrored>
+class _structuredMatrix
+  : public _expression<_structuredMatrix<T, N, Packing, Mirrored>>
+{
+  static_assert(std::is_arithmetic_v<T>, "Do not use user-defined classes.");
+
+  std::array<T, Packing::size> m_data = {};
+
+  using this_type = _structuredMatrix<T, N, Packing, Mirrored>;
+
+  constexpr static bool isStored(const size_t row, const size_t column)
+  {
+    return Packing::first(row) <= column && column <= Packing::last(row);
+  }
+
+  /*******************************************************************************
+   * Constructors.
+   ******************************************************************************/
+public:
+  _structuredMatrix()                          = default;
+  _structuredMatrix(_structuredMatrix &&)      = default;
+  _structuredMatrix(const _structuredMatrix &) = default;
+
+  // Construct from an expression. Only the stored elements are read; the rest
+  // of the expression is assumed to fit the structure.
+  template <typename E>
+  _structuredMatrix(const _expression<E> &expr_)
+  {
+    static_assert(E::rows() == N && E::cols() == N,
+                  "Expression does not evaluate to a matrix of this size.");
+    const E &expr = static_cast<const E &>(expr_);
+
+#ifdef MAT_INSTRUMENTATION
+    instrumentation::detail::_materialisationScope<E> scope(
+        Packing::size, Packing::size * sizeof(T));
+#endif
+
+    if constexpr (isPackedElementwise<E>())
+    {
+      // Same structure on both sides, so the result is the same element-wise
+      // operation on the packed storage; the other half is never touched.
+      simd::elementwise<1,
+                        Packing::size,
+                        packedBroadcast<decltype(expr.lhs)>(),
+                        packedBroadcast<decltype(expr.rhs)>()>(
+          expr.op, flatData(expr.lhs), flatData(expr.rhs), m_data.data());
+    }
+    else
+    {
+      size_t index = 0;
+      for (size_t i = 1; i <= N; ++i)
+        for (size_t j = Packing::first(i); j <= Packing::last(i); ++j)
+        {
+          m_data[index++] = expr.at(i, j);
+        }
+    }
+  }
+
+  /*******************************************************************************
+   * Public interface
+   ******************************************************************************/
+public:
+  constexpr static size_t convertToPackedIndex(size_t rowIndex,
+                                               size_t columnIndex)
+  {
+    EXCEPT_ASSERT((0 < rowIndex && rowIndex <= N)
+                  && (0 < columnIndex && columnIndex <= N));
+    if (Mirrored && !isStored(rowIndex, columnIndex))
+    {
+      std::swap(rowIndex, columnIndex);
+    }
+    EXCEPT_ASSERT(isStored(rowIndex, columnIndex));
+    return Packing::offset(rowIndex) + (columnIndex - Packing::first(rowIndex));
+  }
+
+  // A writable reference to a stored (or mirrored) element. Elements outside
+  // the structure are known zeros, and can't be written to.
+  T &ref(const size_t rowIndex, const size_t columnIndex)
+  {
+    return m_data[convertToPackedIndex(rowIndex, columnIndex)];
+  }
+
+  // Reads any element, whether or not the matrix is const.
+  T at(const size_t rowIndex, const size_t columnIndex) const
+  {
+    if (!Mirrored && !isStored(rowIndex, columnIndex))
+    {
+      EXCEPT_ASSERT((0 < rowIndex && rowIndex <= N)
+                    && (0 < columnIndex && columnIndex <= N));
+      return T(0);
+    }
+    return m_data[convertToPackedIndex(rowIndex, columnIndex)];
+  }
+
+  constexpr static size_t rows()
+  {
+    return N;
+  }
+  constexpr static size_t cols()
+  {
+    return N;
+  }
+
+  // The number of elements actually stored.
+  constexpr static size_t packedSize()
+  {
+    return Packing::size;
+  }
+  /*******************************************************************************
+   * Raw packed storage, for kernels.
+   ******************************************************************************/
+  T *data()
+  {
+    return m_data.data();
+  }
+  const T *data() const
+  {
+    return m_data.data();
+  }
+  /*******************************************************************************
+   * Convenience typedefs.
+   ******************************************************************************/
+  using value_type = T;
+
+private:
+  template <typename Operand>
+  constexpr static _broadcast packedBroadcast()
+  {
+    return is_flat_scalar_v<Operand, T> ? _broadcast::SCALAR
+                                        : _broadcast::NONE;
+  }
+
+  template <typename E>
+  constexpr static bool isPackedElementwise()
+  {
+    if constexpr (is_element_expr_v<E>)
+    {
+      using L = decltype(E::lhs);
+      using R = decltype(E::rhs);
+      return (std::is_same_v<remove_cvref_t<L>, this_type>
+              || is_flat_scalar_v<L, T>)
+             && (std::is_same_v<remove_cvref_t<R>, this_type>
+                 || is_flat_scalar_v<R, T>);
+    }
+    else
+    {
+      return false;
+    }
+  }
+};  // end template class _structuredMatrix
+
+template <typename T, size_t N, typename Packing, bool Mirrored>
+const T *flatData(const _structuredMatrix<T, N, Packing, Mirrored> &m)
+{
+  return m.data();
+}
+}  // end namespace detail
+
+/********************************************************************************
+ * Public names.
+ *******************************************************************************/
+// Stores the upper triangle; the lower one mirrors it.
+template <typename T, size_t N>
+using SymmetricMatrix =
+    detail::_structuredMatrix<T, N, detail::_upperPacking<N>, true>;
+
+template <typename T, size_t N, triangle Triangle = triangle::UPPER>
+using TriangularMatrix =
+    detail::_structuredMatrix<T,
+                              N,
+                              std::conditional_t<Triangle == triangle::UPPER,
+                                                 detail::_upperPacking<N>,
+                                                 detail::_lowerPacking<N>>,
+                              false>;
+
+template <typename T, size_t N>
+using DiagonalMatrix =
+    detail::_structuredMatrix<T, N, detail::_diagonalPacking<N>, false>;
+
+}  // end namespace mat
+
+#endif  // Header guard.
@@ -0,0 +1,564 @@
+#pragma once
+#ifndef JUMBATM_TILED_MATRIX_HPP_INCLUDED  // Begin Header guard.
+#define JUMBATM_TILED_MATRIX_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Matrix.hpp"
+
+namespace mat
+{
+namespace detail
+{
+// An inclusive, 1-based block of rows and columns.
+struct _region
+{
+  size_t firstRow;
+  size_t lastRow;
+  size_t firstColumn;
+  size_t lastColumn;
+};
+
+/********************************************************************************
+ * Prefetching. Before a region of an expression is evaluated, the region is
+ * walked down the expression tree so that every file-backed leaf can start
+ * reading the tiles it will need.
+ *******************************************************************************/
+template <typename E>
+void prefetchRegion(const E &, const _region &)
+{
+}
+
+template <typename L, typename R>
+void prefetchRegion(const _matrixElementExpr<L, R> &expr, const _region &r);
+
+template <typename L, typename R, _comparison Op>
+void prefetchRegion(const _matrixCompareExpr<L, R, Op> &expr, const _region &r);
+
+template <typename L, typename R, _extremum Op>
+void prefetchRegion(const _matrixExtremumExpr<L, R, Op> &expr,
+                    const _region &r);
+
+template <typename M, typename X, typename Y>
+void prefetchRegion(const _matrixSelectExpr<M, X, Y> &expr, const _region &r);
+
+template <typename M>
+void prefetchRegion(const _matrixTranspose<M> &expr, const _region &r);
+
+/********************************************************************************
+ * Aliasing. Whether an expression reads a given matrix anywhere, and whether it
+ * reads it at an element other than the one being written, i.e. through a
+ * transpose.
+ *******************************************************************************/
+template <typename E>
+bool reads(const E &expr, const void *matrix)
+{
+  return static_cast<const void *>(&expr) == matrix;
+}
+
+template <typename L, typename R>
+bool reads(const _matrixElementExpr<L, R> &expr, const void *matrix);
+
+template <typename L, typename R, _comparison Op>
+bool reads(const _matrixCompareExpr<L, R, Op> &expr, const void *matrix);
+
+template <typename L, typename R, _extremum Op>
+bool reads(const _matrixExtremumExpr<L, R, Op> &expr, const void *matrix);
+
+template <typename M, typename X, typename Y>
+bool reads(const _matrixSelectExpr<M, X, Y> &expr, const void *matrix);
+
+template <typename M>
+bool reads(const _matrixTranspose<M> &expr, const void *matrix);
+
+template <typename E>
+bool readsTransposed(const E &, const void *)
+{
+  return false;
+}
+
+template <typename L, typename R>
+bool readsTransposed(const _matrixElementExpr<L, R> &expr,
+                     const void *matrix);
+
+template <typename L, typename R, _comparison Op>
+bool readsTransposed(const _matrixCompareExpr<L, R, Op> &expr,
+                     const void *matrix);
+
+template <typename L, typename R, _extremum Op>
+bool readsTransposed(const _matrixExtremumExpr<L, R, Op> &expr,
+                     const void *matrix);
+
+template <typename M, typename X, typename Y>
+bool readsTransposed(const _matrixSelectExpr<M, X, Y> &expr,
+                     const void *matrix);
+
+template <typename M>
+bool readsTransposed(const _matrixTranspose<M> &expr, const void *matrix);
+
+template <typename L, typename R>
+bool reads(const _matrixElementExpr<L, R> &expr, const void *matrix)
+{
+  return reads(expr.lhs, matrix) || reads(expr.rhs, matrix);
+}
+
+template <typename L, typename R, _comparison Op>
+bool reads(const _matrixCompareExpr<L, R, Op> &expr, const void *matrix)
+{
+  return reads(expr.lhs, matrix) || reads(expr.rhs, matrix);
+}
+
+template <typename L, typename R, _extremum Op>
+bool reads(const _matrixExtremumExpr<L, R, Op> &expr, const void *matrix)
+{
+  return reads(expr.lhs, matrix) || reads(expr.rhs, matrix);
+}
+
+template <typename M, typename X, typename Y>
+bool reads(const _matrixSelectExpr<M, X, Y> &expr, const void *matrix)
+{
+  return reads(expr.mask, matrix) || reads(expr.ifTrue, matrix)
+         || reads(expr.ifFalse, matrix);
+}
+
+template <typename M>
+bool reads(const _matrixTranspose<M> &expr, const void *matrix)
+{
+  return reads(expr.m_matrix, matrix);
+}
+
+template <typename L, typename R>
+bool readsTransposed(const _matrixElementExpr<L, R> &expr, const void *matrix)
+{
+  return readsTransposed(expr.lhs, matrix) || readsTransposed(expr.rhs, matrix);
+}
+
+template <typename L, typename R, _comparison Op>
+bool readsTransposed(const _matrixCompareExpr<L, R, Op> &expr,
+                     const void *matrix)
+{
+  return readsTransposed(expr.lhs, matrix) || readsTransposed(expr.rhs, matrix);
+}
+
+template <typename L, typename R, _extremum Op>
+bool readsTransposed(const _matrixExtremumExpr<L, R, Op> &expr,
+                     const void *matrix)
+{
+  return readsTransposed(expr.lhs, matrix) || readsTransposed(expr.rhs, matrix);
+}
+
+template <typename M, typename X, typename Y>
+bool readsTransposed(const _matrixSelectExpr<M, X, Y> &expr,
+                     const void *matrix)
+{
+  return readsTransposed(expr.mask, matrix)
+         || readsTransposed(expr.ifTrue, matrix)
+         || readsTransposed(expr.ifFalse, matrix);
+}
+
+template <typename M>
+bool readsTransposed(const _matrixTranspose<M> &expr, const void *matrix)
+{
+  return reads(expr.m_matrix, matrix);
+}
+
+// The part of a broadcast operand that region r of the result reads.
+template <typename E>
+_region _broadcastRegion(const _region &r)
+{
+  using ExprNoRef = std::remove_reference_t<E>;
+  return { broadcastIndex<ExprNoRef::rows()>(r.firstRow),
+           broadcastIndex<ExprNoRef::rows()>(r.lastRow),
+           broadcastIndex<ExprNoRef::cols()>(r.firstColumn),
+           broadcastIndex<ExprNoRef::cols()>(r.lastColumn) };
+}
+
+template <typename L, typename R>
+void prefetchRegion(const _matrixElementExpr<L, R> &expr, const _region &r)
+{
+  prefetchRegion(expr.lhs, _broadcastRegion<L>(r));
+  prefetchRegion(expr.rhs, _broadcastRegion<R>(r));
+}
+
+template <typename L, typename R, _comparison Op>
+void prefetchRegion(const _matrixCompareExpr<L, R, Op> &expr, const _region &r)
+{
+  prefetchRegion(expr.lhs, _broadcastRegion<L>(r));
+  prefetchRegion(expr.rhs, _broadcastRegion<R>(r));
+}
+
+template <typename L, typename R, _extremum Op>
+void prefetchRegion(const _matrixExtremumExpr<L, R, Op> &expr,
+                    const _region &r)
+{
+  prefetchRegion(expr.lhs, _broadcastRegion<L>(r));
+  prefetchRegion(expr.rhs, _broadcastRegion<R>(r));
+}
+
+template <typename M, typename X, typename Y>
+void prefetchRegion(const _matrixSelectExpr<M, X, Y> &expr, const _region &r)
+{
+  prefetchRegion(expr.mask, _broadcastRegion<M>(r));
+  prefetchRegion(expr.ifTrue, _broadcastRegion<X>(r));
+  prefetchRegion(expr.ifFalse, _broadcastRegion<Y>(r));
+}
+
+template <typename M>
+void prefetchRegion(const _matrixTranspose<M> &expr, const _region &r)
+{
+  prefetchRegion(expr.m_matrix,
+                 { r.firstColumn, r.lastColumn, r.firstRow, r.lastRow });
+}
+}  // end namespace detail
+
+/********************************************************************************
+ * A matrix stored in a file on local disk, too large to hold in memory.
+ *
+ * The file holds TileRows x TileColumns tiles, each row-major, laid out in
+ * row-major order of tiles; edge tiles are padded to full size. Reads go
+ * through an LRU cache of tiles, so a TiledMatrix can be an operand anywhere
+ * an expression is accepted. The cache and any tiles being read ahead together
+ * stay within the memory budget given at construction, which must hold at
+ * least one tile, and two for read-ahead to happen.
+ *
+ * assign() evaluates an expression into the file one tile at a time, using one
+ * more tile of scratch, and while one tile is computed, the tiles of
+ * file-backed operands that the next one needs are read on another thread.
+ * Tiles are written as they are finished, so the expression may read this
+ * matrix element-wise, but must not transpose it.
+ *
+ * A TiledMatrix is not safe to use from more than one thread at a time.
+ *******************************************************************************/
+template <typename T,
+          size_t Rows,
+          size_t Columns,
+          size_t TileRows    = 256,
+          size_t TileColumns = 256>
+class TiledMatrix
+  : public detail::_expression<
+        TiledMatrix<T, Rows, Columns, TileRows, TileColumns>>
+{
+  static_assert(std::is_arithmetic_v<T>, "Do not use user-defined classes.");
+
+  constexpr static size_t TILE_SIZE    = TileRows * TileColumns;
+  constexpr static size_t TILES_DOWN   = (Rows + TileRows - 1) / TileRows;
+  constexpr static size_t TILES_ACROSS = (Columns + TileColumns - 1)
+                                         / TileColumns;
+  constexpr static size_t TILES        = TILES_DOWN * TILES_ACROSS;
+
+  constexpr static size_t DEFAULT_BUDGET = size_t(64) << 20;  // 64 MiB.
+
+  using tile_type   = std::vector<T>;
+  using loaded_type = std::vector<std::pair<size_t, tile_type>>;
+
+  struct _cachedTile
+  {
+    size_t index;
+    tile_type data;
+  };
+
+  mutable std::fstream m_file;
+  mutable std::mutex m_fileLock;  // The prefetcher reads the file too.
+
+  // Most recently used at the front.
+  mutable std::list<_cachedTile> m_cache;
+  mutable std::unordered_map<size_t, typename std::list<_cachedTile>::iterator>
+      m_cached;
+  const size_t m_capacity;
+
+  mutable std::future<loaded_type> m_prefetch;
+  mutable std::vector<size_t> m_prefetching;
+
+  /*******************************************************************************
+   * Constructors.
+   ******************************************************************************/
+public:
+  // Opens the matrix stored at path, creating a zero-filled one if there is no
+  // file there yet.
+  explicit TiledMatrix(const std::filesystem::path &path,
+                       const size_t memoryBudget = DEFAULT_BUDGET)
+    : m_capacity(memoryBudget / (TILE_SIZE * sizeof(T)))
+  {
+    constexpr auto FILE_SIZE = TILES * TILE_SIZE * sizeof(T);
+
+    if (m_capacity == 0)
+    {
+      throw std::runtime_error("mat: Memory budget is smaller than one tile.");
+    }
+
+    if (!std::filesystem::exists(path))
+    {
+      std::ofstream(path, std::ios::binary);
+    }
+    if (std::filesystem::file_size(path) < FILE_SIZE)
+    {
+      std::filesystem::resize_file(path, FILE_SIZE);
+    }
+
+    m_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file)
+    {
+      throw std::runtime_error("mat: Could not open " + path.string());
+    }
+  }
+
+  TiledMatrix(const TiledMatrix &) = delete;
+
+  ~TiledMatrix()
+  {
+    if (m_prefetch.valid())
+    {
+      m_prefetch.wait();
+    }
+  }
+
+  /*******************************************************************************
+   * Public interface
+   ******************************************************************************/
+public:
+  T at(const size_t rowIndex, const size_t columnIndex) const
+  {
+    EXCEPT_ASSERT((0 < rowIndex && rowIndex <= Rows)
+                  && (0 < columnIndex && columnIndex <= Columns));
+
+    const size_t row    = rowIndex - 1;
+    const size_t column = columnIndex - 1;
+    const tile_type &tile =
+        fetch((row / TileRows) * TILES_ACROSS + column / TileColumns);
+    return tile[(row % TileRows) * TileColumns + column % TileColumns];
+  }
+
+  // Evaluates expr into this matrix, one tile at a time. Throws if expr
+  // transposes this matrix, which would read tiles already overwritten.
+  template <typename E>
+  void assign(const detail::_expression<E> &expr_)
+  {
+    static_assert(E::rows() == Rows && E::cols() == Columns,
+                  "Expression does not evaluate to a matrix of this size.");
+    const E &expr = static_cast<const E &>(expr_);
+
+    if (detail::readsTransposed(expr, this))
+    {
+      throw std::runtime_error(
+          "mat: A TiledMatrix can't be assigned its own transpose.");
+    }
+
+    tile_type tile(TILE_SIZE);
+
+    for (size_t index = 0; index < TILES; ++index)
+    {
+      if (index + 1 < TILES)
+      {
+        detail::prefetchRegion(expr, regionOf(index + 1));
+      }
+
+      const detail::_region r = regionOf(index);
+      for (size_t i = r.firstRow; i <= r.lastRow; ++i)
+        for (size_t j = r.firstColumn; j <= r.lastColumn; ++j)
+        {
+          tile[(i - r.firstRow) * TileColumns + (j - r.firstColumn)] =
+              expr.at(i, j);
+        }
+
+      write(index, tile);
+    }
+  }
+
+  // Starts reading every tile overlapping r that isn't already cached, on
+  // another thread. Tiles in flight count against the memory budget, so the
+  // least recently used tiles are evicted to make room for them first. Only
+  // one read-ahead is in flight at a time, so this waits for the previous one,
+  // which has usually been needed by now anyway.
+  void prefetch(const detail::_region &r) const
+  {
+    std::vector<size_t> wanted;
+    for (size_t tr = (r.firstRow - 1) / TileRows;
+         tr <= (r.lastRow - 1) / TileRows;
+         ++tr)
+      for (size_t tc = (r.firstColumn - 1) / TileColumns;
+           tc <= (r.lastColumn - 1) / TileColumns;
+           ++tc)
+      {
+        // Leave room in the cache for the tile currently being read from.
+        const size_t index = tr * TILES_ACROSS + tc;
+        if (!m_cached.count(index) && !isPrefetching(index)
+            && wanted.size() + 1 < m_capacity)
+        {
+          wanted.push_back(index);
+        }
+      }
+
+    if (wanted.empty())
+    {
+      return;
+    }
+    if (m_prefetch.valid())
+    {
+      collectPrefetch();
+    }
+    while (m_cache.size() + wanted.size() > m_capacity)
+    {
+      evictOldest();
+    }
+
+    m_prefetching = wanted;
+    EXCEPT_ASSERT(m_cache.size() + m_prefetching.size() <= m_capacity);
+    m_prefetch = std::async(std::launch::async, [this, wanted]() {
+      loaded_type loaded;
+      for (size_t index : wanted)
+      {
+        loaded.emplace_back(index, read(index));
+      }
+      return loaded;
+    });
+  }
+
+  constexpr static size_t rows()
+  {
+    return Rows;
+  }
+  constexpr static size_t cols()
+  {
+    return Columns;
+  }
+  /*******************************************************************************
+   * Convenience typedefs.
+   ******************************************************************************/
+  using value_type = T;
+
+private:
+  detail::_region regionOf(const size_t index) const
+  {
+    const size_t firstRow    = (index / TILES_ACROSS) * TileRows + 1;
+    const size_t firstColumn = (index % TILES_ACROSS) * TileColumns + 1;
+    return { firstRow,
+             std::min(firstRow + TileRows - 1, Rows),
+             firstColumn,
+             std::min(firstColumn + TileColumns - 1, Columns) };
+  }
+
+  tile_type read(const size_t index) const
+  {
+    tile_type tile(TILE_SIZE);
+
+    std::lock_guard<std::mutex> guard(m_fileLock);
+    m_file.seekg(index * TILE_SIZE * sizeof(T));
+    m_file.read(reinterpret_cast<char *>(tile.data()), TILE_SIZE * sizeof(T));
+    if (!m_file)
+    {
+      throw std::runtime_error("mat: Could not read tile from disk.");
+    }
+    return tile;
+  }
+
+  void write(const size_t index, const tile_type &tile)
+  {
+    if (isPrefetching(index))
+    {
+      collectPrefetch();  // Otherwise it would bring back the old contents.
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(m_fileLock);
+      m_file.seekp(index * TILE_SIZE * sizeof(T));
+      m_file.write(reinterpret_cast<const char *>(tile.data()),
+                   TILE_SIZE * sizeof(T));
+      m_file.flush();
+      if (!m_file)
+      {
+        throw std::runtime_error("mat: Could not write tile to disk.");
+      }
+    }
+
+    if (auto cached = m_cached.find(index); cached != m_cached.end())
+    {
+      cached->second->data = tile;
+    }
+  }
+
+  void insert(const size_t index, tile_type &&data) const
+  {
+    if (m_cached.count(index))
+    {
+      return;
+    }
+    while (m_cache.size() + m_prefetching.size() >= m_capacity)
+    {
+      evictOldest();
+    }
+    m_cache.push_front({ index, std::move(data) });
+    m_cached[index] = m_cache.begin();
+    EXCEPT_ASSERT(m_cache.size() + m_prefetching.size() <= m_capacity);
+  }
+
+  void evictOldest() const
+  {
+    m_cached.erase(m_cache.back().index);
+    m_cache.pop_back();
+  }
+
+  bool isPrefetching(const size_t index) const
+  {
+    return std::find(m_prefetching.begin(), m_prefetching.end(), index)
+           != m_prefetching.end();
+  }
+
+  // Waits for the read-ahead in flight and moves its tiles into the cache.
+  void collectPrefetch() const
+  {
+    m_prefetching.clear();
+    for (auto &[index, data] : m_prefetch.get())
+    {
+      insert(index, std::move(data));
+    }
+  }
+
+  const tile_type &fetch(const size_t index) const
+  {
+    if (auto cached = m_cached.find(index); cached != m_cached.end())
+    {
+      m_cache.splice(m_cache.begin(), m_cache, cached->second);
+      return m_cache.front().data;
+    }
+
+    if (isPrefetching(index))
+    {
+      collectPrefetch();
+      return fetch(index);
+    }
+
+    insert(index, read(index));
+    return m_cache.front().data;
+  }
+};  // end template class TiledMatrix
+
+namespace detail
+{
+template <typename T,
+          size_t Rows,
+          size_t Columns,
+          size_t TileRows,
+          size_t TileColumns>
+void prefetchRegion(
+    const TiledMatrix<T, Rows, Columns, TileRows, TileColumns> &matrix,
+    const _region &r)
+{
+  matrix.prefetch(r);
+}
+}  // end namespace detail
+
+}  // end namespace mat
+
+#endif  // Header guard.
@@ -0,0 +1,72 @@
+#include "Matrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+constexpr Matrix<int, 3, 3> testMatrix = { { 1, 2, 3 },
+                                           { 4, 5, 6 },
+                                           { 7, 8, 9 } };
+}  // namespace
+
+TEST_CASE("A row vector is broadcast down every row of a matrix.")
+{
+  Matrix<int, 1, 3> bias = { 10, 20, 30 };
+  Matrix<int, 3, 3> ans  = testMatrix + bias;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(ans.at(i, j) == testMatrix.at(i, j) + bias.at(1, j));
+    }
+}
+
+TEST_CASE("A column vector is broadcast across every column of a matrix.")
+{
+  Matrix<int, 3, 1> scale = { 1, 2, 3 };
+  Matrix<int, 3, 3> ans   = scale * testMatrix;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(ans.at(i, j) == scale.at(i, 1) * testMatrix.at(i, j));
+    }
+}
+
+TEST_CASE("A row vector and a column vector broadcast to a full matrix.")
+{
+  Matrix<int, 1, 4> row    = { 1, 2, 3, 4 };
+  Matrix<int, 3, 1> column = { 10, 20, 30 };
+  auto expr                = column - row;
+
+  static_assert(decltype(expr)::rows() == 3 && decltype(expr)::cols() == 4);
+
+  Matrix<int, 3, 4> ans = expr;
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 4; ++j)
+    {
+      REQUIRE(ans.at(i, j) == column.at(i, 1) - row.at(1, j));
+    }
+}
+
+TEST_CASE("A scalar on the left keeps the shape of the right operand.")
+{
+  auto expr = 2 * testMatrix;
+
+  static_assert(decltype(expr)::rows() == 3 && decltype(expr)::cols() == 3);
+  REQUIRE(expr.at(3, 1) == 14);
+}
+
+TEST_CASE("Broadcasting composes with transposed operands.")
+{
+  Matrix<int, 3, 1> column = { 1, 2, 3 };
+  Matrix<int, 3, 3> ans    = testMatrix + mat::transpose(column);
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(ans.at(i, j) == testMatrix.at(i, j) + column.at(j, 1));
+    }
+}
@@ -0,0 +1,35 @@
+// Compile-time benchmark: long chains of element-wise operations, mixing
+// scalars, broadcasts, transposes and generators.
+#include "Matrix.hpp"
+
+using namespace mat;
+
+Matrix<double, 16, 16> deepExpression(const Matrix<double, 16, 16> &a,
+                                      const Matrix<double, 16, 16> &b,
+                                      const Matrix<double, 1, 16> &row,
+                                      const Matrix<double, 16, 1> &column)
+{
+  return ((((((a + b) * 2.0 - row) / 3.0 + column) * a - b) + 1.0)
+              * transpose(a)
+          - (((b * 0.5 + row) - column) / (a + 1.0)) + identity<double, 16>()
+          + ((a - b) * (a + b) - transpose(b) * 4.0) / 2.0)
+         * constant<double, 16, 16>(0.25);
+}
+
+Matrix<int, 8, 8> deepIntegerExpression(const Matrix<int, 8, 8> &a)
+{
+  return a + 1 + a * 2 - 3 + a / 4 + 5 - a * a + 6 + a - 7 + a * 8 - 9 + a;
+}
+
+Matrix<float, 100, 100> largeMaterialisations(const Matrix<float, 100, 100> &a,
+                                              const Matrix<float, 100, 100> &b)
+{
+  Matrix<float, 100, 100> sum        = a + b;
+  Matrix<float, 100, 100> difference = a - b;
+  Matrix<float, 100, 100> product    = a * b;
+  Matrix<float, 100, 100> quotient   = a / b;
+  Matrix<float, 100, 100> transposed = transpose(sum);
+  Matrix<float, 100, 100> scaled     = 2.0f * difference;
+  Matrix<float, 100, 100> shifted    = product + 1.0f;
+  return quotient + transposed + scaled + shifted;
+}
@@ -0,0 +1,20 @@
+// Compile-time benchmark: a large constant matrix built from nested
+// initializer lists, evaluated by the compiler.
+#include "Matrix.hpp"
+
+#define TEN 1, 2, 3, 4, 5, 6, 7, 8, 9, 10
+#define ROW \
+  {                                                  \
+    TEN, TEN, TEN, TEN, TEN, TEN, TEN, TEN, TEN, TEN \
+  }
+#define TEN_ROWS ROW, ROW, ROW, ROW, ROW, ROW, ROW, ROW, ROW, ROW
+
+constexpr mat::Matrix<int, 100, 100> large = { TEN_ROWS, TEN_ROWS, TEN_ROWS,
+                                               TEN_ROWS, TEN_ROWS, TEN_ROWS,
+                                               TEN_ROWS, TEN_ROWS, TEN_ROWS,
+                                               TEN_ROWS };
+
+int largeSum()
+{
+  return mat::sum(large);
+}
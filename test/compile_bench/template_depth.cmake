@@ -0,0 +1,49 @@
+# Reports the template instantiation depth each compile benchmark needs: the
+# lowest -ftemplate-depth it still compiles with, found by bisection between
+# 1 and MAX_DEPTH. Run by the CompileBenchDepth target, which passes:
+#   CXX        the C++ compiler
+#   INCLUDE    the library's include directory
+#   SOURCES    the benchmark sources, as a list
+#   MAX_DEPTH  the depth the CompileBench build is gated at
+
+function(compiles_at SOURCE DEPTH RESULT)
+  execute_process(
+    COMMAND ${CXX} -std=c++17 -fsyntax-only -I${INCLUDE}
+            -ftemplate-depth=${DEPTH} ${SOURCE}
+    RESULT_VARIABLE status
+    OUTPUT_QUIET
+    ERROR_QUIET)
+  if(status EQUAL 0)
+    set(${RESULT} TRUE PARENT_SCOPE)
+  else()
+    set(${RESULT} FALSE PARENT_SCOPE)
+  endif()
+endfunction()
+
+foreach(source ${SOURCES})
+  get_filename_component(name ${source} NAME)
+
+  compiles_at(${source} ${MAX_DEPTH} passes)
+  if(NOT passes)
+    message(SEND_ERROR
+      "${name}: needs a template depth above the limit of ${MAX_DEPTH}")
+  else()
+    # Invariant: low fails (or is 0), high passes.
+    set(low 0)
+    set(high ${MAX_DEPTH})
+    math(EXPR gap "${high} - ${low}")
+    while(gap GREATER 1)
+      math(EXPR middle "(${low} + ${high}) / 2")
+      compiles_at(${source} ${middle} passes)
+      if(passes)
+        set(high ${middle})
+      else()
+        set(low ${middle})
+      endif()
+      math(EXPR gap "${high} - ${low}")
+    endwhile()
+
+    message(STATUS
+      "${name}: template instantiation depth ${high} (limit ${MAX_DEPTH})")
+  endif()
+endforeach()
@@ -45,3 +45,12 @@ TEST_CASE("Matrices can take advantage of move semantics.")
   Matrix<int, 3, 3> a = std::move(m);
   (void)a;
 }
+
+TEST_CASE("A flat initializer list longer than the matrix is rejected.")
+{
+  using vector = Matrix<int, 1, 3>;
+  REQUIRE_THROWS(vector{ 1, 2, 3, 4, 5, 6, 7, 8 });
+
+  vector v = { 1, 2, 3 };
+  REQUIRE(v.at(1, 3) == 3);
+}
@@ -0,0 +1,62 @@
+#include <tuple>
+
+#include "Matrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+constexpr int RANDOM_MATRIX_SIZE = 50;
+}  // namespace
+
+TEST_CASE("assign_all evaluates every expression into its target.")
+{
+  Matrix<int, RANDOM_MATRIX_SIZE, RANDOM_MATRIX_SIZE> a;
+  initialise_random(a);
+
+  decltype(a) b;
+  initialise_random(b);
+
+  decltype(a) r, s, t;
+  mat::assign_all(std::tie(r, s, t), a + b, a - b, a * b);
+
+  for (size_t i = 1; i <= RANDOM_MATRIX_SIZE; ++i)
+    for (size_t j = 1; j <= RANDOM_MATRIX_SIZE; ++j)
+    {
+      REQUIRE(r.at(i, j) == a.at(i, j) + b.at(i, j));
+      REQUIRE(s.at(i, j) == a.at(i, j) - b.at(i, j));
+      REQUIRE(t.at(i, j) == a.at(i, j) * b.at(i, j));
+    }
+}
+
+TEST_CASE("assign_all targets may have different element types.")
+{
+  Matrix<int, 2, 3> a = { { 1, 2, 3 }, { 4, 5, 6 } };
+  Matrix<int, 2, 3> sum;
+  Matrix<double, 2, 3> half;
+
+  mat::assign_all(std::tie(sum, half), a + a, a / 2.0);
+
+  for (size_t i = 1; i <= 2; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(sum.at(i, j) == 2 * a.at(i, j));
+      REQUIRE(half.at(i, j) == a.at(i, j) / 2.0);
+    }
+}
+
+TEST_CASE("assign_all lets later expressions read earlier targets.")
+{
+  Matrix<int, 2, 2> a = { { 1, 2 }, { 3, 4 } };
+  Matrix<int, 2, 2> r, s;
+
+  mat::assign_all(std::tie(r, s), a * 2, r + a);
+
+  for (size_t i = 1; i <= 2; ++i)
+    for (size_t j = 1; j <= 2; ++j)
+    {
+      REQUIRE(s.at(i, j) == 3 * a.at(i, j));
+    }
+}
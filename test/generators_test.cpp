@@ -0,0 +1,133 @@
+#include "Matrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+constexpr Matrix<int, 3, 3> testMatrix = { { 1, 2, 3 },
+                                           { 4, 5, 6 },
+                                           { 7, 8, 9 } };
+}  // namespace
+
+TEST_CASE("identity has ones on the diagonal and zeros elsewhere.")
+{
+  Matrix<int, 4, 4> ans = mat::identity<int, 4>();
+
+  for (size_t i = 1; i <= 4; ++i)
+    for (size_t j = 1; j <= 4; ++j)
+    {
+      REQUIRE(ans.at(i, j) == (i == j ? 1 : 0));
+    }
+}
+
+TEST_CASE("Generators fold into surrounding expressions.")
+{
+  Matrix<double, 3, 3> a   = { { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } };
+  Matrix<double, 3, 3> ans = a + 0.5 * mat::identity<double, 3>();
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(ans.at(i, j) == a.at(i, j) + (i == j ? 0.5 : 0.0));
+    }
+}
+
+TEST_CASE("constant returns its value everywhere.")
+{
+  Matrix<int, 3, 3> ans = testMatrix - mat::constant<int, 3, 3>(1);
+
+  int expectedValue = 0;
+  for (auto &elem : ans)
+  {
+    REQUIRE(elem == expectedValue++);
+  }
+}
+
+TEST_CASE("diagonal places a vector along the diagonal.")
+{
+  Matrix<int, 1, 3> row    = { 4, 5, 6 };
+  Matrix<int, 3, 1> column = { 7, 8, 9 };
+
+  Matrix<int, 3, 3> fromRow    = mat::diagonal(row);
+  Matrix<int, 3, 3> fromColumn = mat::diagonal(column);
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(fromRow.at(i, j) == (i == j ? row.at(1, i) : 0));
+      REQUIRE(fromColumn.at(i, j) == (i == j ? column.at(i, 1) : 0));
+    }
+}
+
+TEST_CASE("random is reproducible from its seed.")
+{
+  auto expr             = mat::random<int, 10, 10>(42);
+  Matrix<int, 10, 10> a = expr;
+  Matrix<int, 10, 10> b = mat::random<int, 10, 10>(42);
+  Matrix<int, 10, 10> c = mat::random<int, 10, 10>(43);
+
+  size_t differences = 0;
+  for (size_t i = 1; i <= 10; ++i)
+    for (size_t j = 1; j <= 10; ++j)
+    {
+      REQUIRE(a.at(i, j) == b.at(i, j));
+      REQUIRE(a.at(i, j) == expr.at(i, j));
+      differences += a.at(i, j) != c.at(i, j);
+    }
+  REQUIRE(differences > 90);
+}
+
+TEST_CASE("Single precision random values never round up to 1.")
+{
+  // Enough draws that, rounding a 53-bit fraction to float, some would.
+  size_t outOfRange = 0;
+  for (uint64_t index = 0; index < (uint64_t(1) << 22); ++index)
+  {
+    const float value = detail::randomValue<float>(0, index);
+    outOfRange += !(0.0f <= value && value < 1.0f);
+  }
+  REQUIRE(outOfRange == 0);
+}
+
+TEST_CASE("Floating point random matrices are in [0, 1) at every SIMD level.")
+{
+  const simd_level original = simdLevel();
+
+  for (auto level :
+       { simd_level::BASELINE, simd_level::AVX2, simd_level::AVX512 })
+  {
+    setSimdLevel(level);
+
+    auto expr                 = mat::random<double, 20, 30>(7);
+    Matrix<double, 20, 30> a = expr;
+
+    for (size_t i = 1; i <= 20; ++i)
+      for (size_t j = 1; j <= 30; ++j)
+      {
+        REQUIRE(a.at(i, j) == expr.at(i, j));
+        REQUIRE(0.0 <= a.at(i, j));
+        REQUIRE(a.at(i, j) < 1.0);
+      }
+  }
+
+  setSimdLevel(original);
+}
+
+TEST_CASE("iota counts up from its start in row-major order.")
+{
+  Matrix<int, 3, 4> counted    = mat::iota<int, 3, 4>();
+  Matrix<double, 2, 3> stepped = mat::iota<double, 2, 3>(1.0, 0.5) + 1.0;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 4; ++j)
+    {
+      REQUIRE(counted.at(i, j) == int((i - 1) * 4 + (j - 1)));
+    }
+  for (size_t i = 1; i <= 2; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(stepped.at(i, j) == 2.0 + 0.5 * ((i - 1) * 3 + (j - 1)));
+    }
+}
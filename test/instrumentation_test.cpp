@@ -0,0 +1,103 @@
+// Built into its own executable, with MAT_INSTRUMENTATION defined for every
+// translation unit in it.
+#include <vector>
+
+#include "Matrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+std::vector<instrumentation::event> events;
+
+void recordEvent(const instrumentation::event &e)
+{
+  events.push_back(e);
+}
+}  // namespace
+
+TEST_CASE("Materialising an expression is counted against its type.")
+{
+  instrumentation::reset();
+
+  Matrix<int, 4, 4> a = { { 1, 2, 3, 4 },
+                          { 5, 6, 7, 8 },
+                          { 9, 10, 11, 12 },
+                          { 13, 14, 15, 16 } };
+  auto expr           = a + a;
+
+  Matrix<int, 4, 4> b = expr;
+  Matrix<int, 4, 4> c = expr;
+  (void)b;
+  (void)c;
+
+  auto counted = instrumentation::countersFor<decltype(expr)>();
+  REQUIRE(counted.materialisations == 2);
+  REQUIRE(counted.elements == 2 * 16);
+  REQUIRE(counted.bytes == 2 * 16 * sizeof(int));
+
+  bool found = false;
+  for (auto &snapshot : instrumentation::counters())
+  {
+    found |= snapshot.expression == counted.expression;
+  }
+  REQUIRE(found);
+}
+
+TEST_CASE("Bounds checks are counted.")
+{
+  Matrix<int, 2, 2> a = { { 1, 2 }, { 3, 4 } };
+
+  instrumentation::reset();
+  (void)a.at(1, 1);
+  (void)a.at(2, 2);
+
+  REQUIRE(instrumentation::assertions() == 2);
+}
+
+TEST_CASE("Checks made during constant evaluation still compile.")
+{
+  constexpr Matrix<int, 1, 3> v = { 1, 2, 3 };
+  constexpr size_t k            = Matrix<int, 3, 3>::convertToFlatIndex(2, 3);
+  static_assert(k == 5);
+
+  instrumentation::reset();
+  REQUIRE(v.at(1, 3) == 3);
+  REQUIRE(instrumentation::assertions() == 1);
+}
+
+TEST_CASE("An installed hook sees every materialisation.")
+{
+  Matrix<float, 3, 2> a;
+  initialise_random(a);
+
+  events.clear();
+  auto previous = instrumentation::setHook(recordEvent);
+
+  Matrix<float, 2, 3> t = mat::transpose(a);
+  Matrix<float, 3, 2> s = a * 2.0f;
+  (void)t;
+  (void)s;
+
+  REQUIRE(instrumentation::setHook(previous) == recordEvent);
+  REQUIRE(events.size() == 2);
+  REQUIRE(events[0].elements == 6);
+  REQUIRE(events[1].bytes == 6 * sizeof(float));
+}
+
+TEST_CASE("A fused assignment is counted as one materialisation.")
+{
+  Matrix<int, 2, 2> a = { { 1, 2 }, { 3, 4 } };
+  Matrix<int, 2, 2> r, s;
+
+  events.clear();
+  auto previous = instrumentation::setHook(recordEvent);
+  mat::assign_all(std::tie(r, s), a + a, a - a);
+  instrumentation::setHook(previous);
+
+  REQUIRE(events.size() == 1);
+  REQUIRE(events[0].elements == 2 * 4);
+  REQUIRE(events[0].bytes == 2 * 4 * sizeof(int));
+}
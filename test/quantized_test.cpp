@@ -0,0 +1,101 @@
+#include <cmath>
+#include <cstdint>
+
+#include "Matrix.hpp"
+#include "QuantizedMatrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+constexpr float SCALE = 0.05f;
+}  // namespace
+
+TEST_CASE("Quantizing and dequantizing round-trips to within half a step.")
+{
+  Matrix<float, 4, 4> x = mat::random<float, 4, 4>(1) * 4.0f - 2.0f;
+
+  QuantizedMatrix<int8_t, 4, 4> q = mat::quantize<int8_t>(x, SCALE, 3);
+  REQUIRE(q.scale() == SCALE);
+  REQUIRE(q.zeroPoint() == 3);
+
+  Matrix<float, 4, 4> y = mat::dequantize(q);
+
+  for (size_t i = 1; i <= 4; ++i)
+    for (size_t j = 1; j <= 4; ++j)
+    {
+      REQUIRE(std::abs(y.at(i, j) - x.at(i, j)) <= SCALE / 2 + 1e-6f);
+    }
+}
+
+TEST_CASE("Quantizing saturates instead of wrapping.")
+{
+  Matrix<float, 1, 2> x = { 1000.0f, -1000.0f };
+
+  QuantizedMatrix<int8_t, 1, 2> q = mat::quantize<int8_t>(x, 1.0f, 0);
+
+  REQUIRE(q.raw(1, 1) == 127);
+  REQUIRE(q.raw(1, 2) == -128);
+}
+
+TEST_CASE("Products of quantized matrices accumulate in a wide type.")
+{
+  QuantizedMatrix<int8_t, 2, 2> a(0.5f, -128);
+  QuantizedMatrix<int8_t, 2, 2> b(0.25f, -128);
+  for (auto &elem : a)
+  {
+    elem = 127;
+  }
+  for (auto &elem : b)
+  {
+    elem = 127;
+  }
+
+  auto product = a * b;
+
+  static_assert(std::is_same_v<decltype(product)::value_type, int32_t>);
+  REQUIRE(product.at(1, 1) == 255 * 255);
+  REQUIRE(mat::sum(product) == 4 * 255 * 255);
+
+  Matrix<float, 2, 2> real = mat::dequantize(product, a.scale() * b.scale());
+  REQUIRE(real.at(2, 2) == Approx(255 * 0.5 * 255 * 0.25));
+}
+
+TEST_CASE("Summing a quantized matrix sums its centred values.")
+{
+  QuantizedMatrix<int8_t, 5, 7> q(0.5f, -100);
+  for (auto &elem : q)
+  {
+    elem = 127;
+  }
+  q.raw(3, 4) = -128;
+
+  REQUIRE(mat::sum(q) == 34 * 227 + (-28));
+}
+
+TEST_CASE("16 bit quantized values accumulate in 64 bits.")
+{
+  QuantizedMatrix<int16_t, 1, 1> a(1.0f, -32768);
+  a.raw(1, 1) = 32767;
+
+  static_assert(std::is_same_v<decltype(a * a)::value_type, int64_t>);
+  REQUIRE((a * a).at(1, 1) == int64_t(65535) * 65535);
+}
+
+TEST_CASE("Requantizing an accumulator skips floating point storage.")
+{
+  QuantizedMatrix<int8_t, 2, 2> a(0.1f, 0);
+  QuantizedMatrix<int8_t, 2, 2> b(0.1f, 0);
+  a.raw(1, 1) = 20;
+  b.raw(1, 1) = 30;
+
+  QuantizedMatrix<int8_t, 2, 2> c =
+      mat::requantize<int8_t>(a * b, a.scale() * b.scale(), 0.1f, 5);
+
+  REQUIRE(c.scale() == 0.1f);
+  REQUIRE(c.zeroPoint() == 5);
+  REQUIRE(c.raw(1, 1) == 60 + 5);  // 2.0 * 3.0 = 6.0 = 60 steps of 0.1.
+  REQUIRE(c.raw(2, 2) == 5);
+}
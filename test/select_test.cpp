@@ -0,0 +1,303 @@
+#include "Matrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+const Matrix<int, 3, 3> testMatrix = { { -4, 2, 0 },
+                                       { 5, -1, 7 },
+                                       { 3, -6, 1 } };
+
+const Matrix<int, 3, 3> otherMatrix = { { 1, 2, 3 },
+                                        { 4, 5, 6 },
+                                        { 7, 8, 9 } };
+
+constexpr simd_level levels[] = { simd_level::BASELINE,
+                                  simd_level::AVX2,
+                                  simd_level::AVX512 };
+
+bool isThree(const Matrix<int, 1, 1> &s)
+{
+  return s == 3;
+}
+}  // namespace
+
+TEST_CASE("Comparisons give an element-wise mask.")
+{
+  Matrix<bool, 3, 3> less    = testMatrix < otherMatrix;
+  Matrix<bool, 3, 3> lessEq  = testMatrix <= otherMatrix;
+  Matrix<bool, 3, 3> greater = testMatrix > otherMatrix;
+  Matrix<bool, 3, 3> greatEq = testMatrix >= otherMatrix;
+  Matrix<bool, 3, 3> equal   = testMatrix == otherMatrix;
+  Matrix<bool, 3, 3> unequal = testMatrix != otherMatrix;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      const int a = testMatrix.at(i, j);
+      const int b = otherMatrix.at(i, j);
+      REQUIRE(less.at(i, j) == (a < b));
+      REQUIRE(lessEq.at(i, j) == (a <= b));
+      REQUIRE(greater.at(i, j) == (a > b));
+      REQUIRE(greatEq.at(i, j) == (a >= b));
+      REQUIRE(equal.at(i, j) == (a == b));
+      REQUIRE(unequal.at(i, j) == (a != b));
+    }
+}
+
+TEST_CASE("Comparisons against scalars and broadcast vectors.")
+{
+  const int threshold        = 0;
+  const Matrix<int, 1, 3> row = { 0, 0, 1 };
+
+  Matrix<bool, 3, 3> positive = testMatrix > threshold;
+  Matrix<bool, 3, 3> zero     = 0 == testMatrix;
+  Matrix<bool, 3, 3> above    = testMatrix > row;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(positive.at(i, j) == (testMatrix.at(i, j) > 0));
+      REQUIRE(zero.at(i, j) == (testMatrix.at(i, j) == 0));
+      REQUIRE(above.at(i, j) == (testMatrix.at(i, j) > row.at(1, j)));
+    }
+}
+
+TEST_CASE("Wrapped scalars compare as plain values.")
+{
+  const Matrix<int, 1, 1> three = 3;
+  const Matrix<int, 1, 1> four  = 4;
+
+  static_assert(std::is_same_v<decltype(three == 3), bool>);
+  static_assert(std::is_same_v<decltype(three < four), bool>);
+  REQUIRE(isThree(three));
+  REQUIRE_FALSE(isThree(four));
+  REQUIRE(three < four);
+
+  // Against a real expression it is still a broadcast mask.
+  Matrix<bool, 3, 3> equal = testMatrix == three;
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(equal.at(i, j) == (testMatrix.at(i, j) == 3));
+    }
+}
+
+TEST_CASE("where selects element-wise between two expressions.")
+{
+  Matrix<int, 3, 3> ans =
+      mat::where(testMatrix < otherMatrix, testMatrix, otherMatrix * 10);
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      const int a = testMatrix.at(i, j);
+      const int b = otherMatrix.at(i, j);
+      REQUIRE(ans.at(i, j) == (a < b ? a : b * 10));
+    }
+}
+
+TEST_CASE("where takes a materialised mask and scalar branches.")
+{
+  const Matrix<bool, 3, 3> mask = testMatrix > 0;
+  const double fill             = -1.5;
+
+  Matrix<double, 3, 3> ans = mat::where(mask, 2.0, fill);
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(ans.at(i, j) == (testMatrix.at(i, j) > 0 ? 2.0 : fill));
+    }
+}
+
+TEST_CASE("A fused ReLU matches its element-wise definition.")
+{
+  Matrix<double, 32, 32> noise;
+  initialise_random(noise);
+  const Matrix<double, 32, 32> x = noise - 0.5;
+
+  Matrix<double, 32, 32> ans = mat::where(x > 0.0, x, 0.0);
+
+  for (size_t i = 1; i <= 32; ++i)
+    for (size_t j = 1; j <= 32; ++j)
+    {
+      REQUIRE(ans.at(i, j) == (x.at(i, j) > 0.0 ? x.at(i, j) : 0.0));
+    }
+}
+
+TEST_CASE("min, max and clamp are element-wise.")
+{
+  const int low  = -2;
+  const int high = 4;
+
+  Matrix<int, 3, 3> smallest = mat::min(testMatrix, otherMatrix);
+  Matrix<int, 3, 3> largest  = mat::max(testMatrix, otherMatrix);
+  Matrix<int, 3, 3> clamped  = mat::clamp(testMatrix, low, high);
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      const int a = testMatrix.at(i, j);
+      const int b = otherMatrix.at(i, j);
+      REQUIRE(smallest.at(i, j) == std::min(a, b));
+      REQUIRE(largest.at(i, j) == std::max(a, b));
+      REQUIRE(clamped.at(i, j) == std::clamp(a, low, high));
+    }
+}
+
+TEST_CASE("clamp takes broadcast bounds.")
+{
+  const Matrix<int, 3, 1> low  = { -5, 0, -1 };
+  const Matrix<int, 1, 3> high = { 1, 6, 2 };
+
+  Matrix<int, 3, 3> ans = mat::clamp(testMatrix, low, high);
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(ans.at(i, j)
+              == std::min(std::max(testMatrix.at(i, j), low.at(i, 1)),
+                          high.at(1, j)));
+    }
+}
+
+TEST_CASE("Every SIMD level compares, selects and clamps the same.")
+{
+  Matrix<float, 17, 9> a;
+  Matrix<float, 17, 9> b;
+  initialise_random(a);
+  initialise_random(b);
+
+  const simd_level original = simdLevel();
+
+  setSimdLevel(simd_level::BASELINE);
+  const Matrix<bool, 17, 9> expectedMask  = a < b;
+  const Matrix<float, 17, 9> expectedPick = mat::where(expectedMask, a, 0.5f);
+  const Matrix<float, 17, 9> expectedMax  = mat::max(a, b);
+
+  for (auto level : { simd_level::AVX2, simd_level::AVX512 })
+  {
+    setSimdLevel(level);
+    const Matrix<bool, 17, 9> mask  = a < b;
+    const Matrix<float, 17, 9> pick = mat::where(mask, a, 0.5f);
+    const Matrix<float, 17, 9> max  = mat::max(a, b);
+
+    for (size_t i = 1; i <= 17; ++i)
+      for (size_t j = 1; j <= 9; ++j)
+      {
+        REQUIRE(mask.at(i, j) == expectedMask.at(i, j));
+        REQUIRE(pick.at(i, j) == expectedPick.at(i, j));
+        REQUIRE(max.at(i, j) == expectedMax.at(i, j));
+      }
+  }
+
+  setSimdLevel(original);
+}
+
+TEST_CASE("Fused comparisons, selects and clamps match at every SIMD level.")
+{
+  Matrix<float, 17, 9> x;
+  Matrix<float, 17, 1> low;
+  Matrix<float, 1, 9> high;
+  Matrix<float, 17, 1> column;
+  initialise_random(x);
+  initialise_random(low);
+  initialise_random(high);
+  initialise_random(column);
+
+  const auto relu      = mat::where(x > 0.5f, x, 0.0f);
+  const auto clamped   = mat::clamp(x, low, high);
+  const auto columnMax = mat::max(column, 0.25f);
+
+  // These go through the fused kernel rather than at().
+  static_assert(
+      detail::_kernelFor<std::decay_t<decltype(relu)>, float, 17, 9>::fused);
+  static_assert(
+      detail::_kernelFor<std::decay_t<decltype(clamped)>, float, 17, 9>::fused);
+  static_assert(
+      detail::_kernelFor<std::decay_t<decltype(columnMax)>, float, 17, 1>::
+          fused);
+
+  const simd_level original = simdLevel();
+
+  for (auto level : levels)
+  {
+    setSimdLevel(level);
+
+    const Matrix<float, 17, 9> reluAns    = relu;
+    const Matrix<float, 17, 9> clampedAns = clamped;
+    const Matrix<float, 17, 1> maxAns     = columnMax;
+    const Matrix<bool, 17, 9> maskAns     = x < high;
+
+    for (size_t i = 1; i <= 17; ++i)
+    {
+      REQUIRE(maxAns.at(i, 1) == std::max(column.at(i, 1), 0.25f));
+      for (size_t j = 1; j <= 9; ++j)
+      {
+        const float e = x.at(i, j);
+        REQUIRE(reluAns.at(i, j) == (e > 0.5f ? e : 0.0f));
+        REQUIRE(clampedAns.at(i, j)
+                == std::min(std::max(e, low.at(i, 1)), high.at(1, j)));
+        REQUIRE(maskAns.at(i, j) == (e < high.at(1, j)));
+      }
+    }
+  }
+
+  setSimdLevel(original);
+}
+
+TEST_CASE("Selects over arithmetic fuse at every SIMD level.")
+{
+  // Wider than a fused block, so that rows are split.
+  Matrix<float, 5, 300> x;
+  Matrix<float, 5, 300> y;
+  Matrix<float, 1, 300> bias;
+  initialise_random(x);
+  initialise_random(y);
+  initialise_random(bias);
+  const Matrix<int, 5, 300> a = mat::iota<int, 5, 300>(-700);
+  const Matrix<int, 5, 1> b   = { 1, -2, 3, -4, 5 };
+
+  const auto scaled  = mat::where(x > 0.5f, x * 2.0f, 0.0f);
+  const auto affine  = mat::max(x * y + bias, 0.5f);
+  const auto masked  = mat::where(x < y, x / y - 1.0f, y);
+  const auto integer = mat::clamp(a - b * 3, -500, 500);
+
+  static_assert(
+      detail::_kernelFor<std::decay_t<decltype(scaled)>, float, 5, 300>::fused);
+  static_assert(
+      detail::_kernelFor<std::decay_t<decltype(affine)>, float, 5, 300>::fused);
+  static_assert(
+      detail::_kernelFor<std::decay_t<decltype(masked)>, float, 5, 300>::fused);
+  static_assert(
+      detail::_kernelFor<std::decay_t<decltype(integer)>, int, 5, 300>::fused);
+
+  const simd_level original = simdLevel();
+
+  for (auto level : levels)
+  {
+    setSimdLevel(level);
+
+    const Matrix<float, 5, 300> scaledAns = scaled;
+    const Matrix<float, 5, 300> affineAns = affine;
+    const Matrix<float, 5, 300> maskedAns = masked;
+    const Matrix<int, 5, 300> integerAns  = integer;
+
+    for (size_t i = 1; i <= 5; ++i)
+      for (size_t j = 1; j <= 300; ++j)
+      {
+        const float e = x.at(i, j);
+        const float f = y.at(i, j);
+        REQUIRE(scaledAns.at(i, j) == (e > 0.5f ? e * 2.0f : 0.0f));
+        REQUIRE(affineAns.at(i, j) == std::max(e * f + bias.at(1, j), 0.5f));
+        REQUIRE(maskedAns.at(i, j) == (e < f ? e / f - 1.0f : f));
+        REQUIRE(integerAns.at(i, j)
+                == std::clamp(a.at(i, j) - b.at(i, 1) * 3, -500, 500));
+      }
+  }
+
+  setSimdLevel(original);
+}
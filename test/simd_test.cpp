@@ -0,0 +1,178 @@
+#include <cstdlib>
+#include <random>
+
+#include "Matrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+constexpr simd_level levels[] = { simd_level::BASELINE,
+                                  simd_level::AVX2,
+                                  simd_level::AVX512 };
+
+constexpr int RANDOM_MATRIX_SIZE = 37;  // Not a multiple of any vector width.
+
+// Random ints small enough that sums and products of two of them, or three
+// times one of them, can't overflow.
+template <typename Matrix>
+void initialise_bounded(Matrix &m)
+{
+  std::mt19937 generator{ std::random_device{}() };
+  std::uniform_int_distribution<int> distribution(-1000, 1000);
+  for (auto &elem : m)
+  {
+    elem = distribution(generator);
+  }
+}
+}  // namespace
+
+TEST_CASE("Requesting a SIMD level is clamped to what the CPU supports.")
+{
+  const simd_level original = simdLevel();
+
+  for (auto level : levels)
+  {
+    const simd_level set = setSimdLevel(level);
+    REQUIRE(set <= level);
+    REQUIRE(set <= supportedSimdLevel());
+    REQUIRE(simdLevel() == set);
+  }
+
+  setSimdLevel(original);
+}
+
+TEST_CASE("MAT_SIMD_LEVEL overrides the detected SIMD level.")
+{
+  setenv("MAT_SIMD_LEVEL", "sse2", 1);
+  REQUIRE(detail::initialSimdLevel() == simd_level::BASELINE);
+
+  setenv("MAT_SIMD_LEVEL", "avx2", 1);
+  REQUIRE(detail::initialSimdLevel()
+          == std::min(simd_level::AVX2, supportedSimdLevel()));
+
+  setenv("MAT_SIMD_LEVEL", "not-a-level", 1);
+  REQUIRE(detail::initialSimdLevel() == supportedSimdLevel());
+
+  unsetenv("MAT_SIMD_LEVEL");
+}
+
+TEST_CASE("Every SIMD level evaluates element-wise expressions the same way.")
+{
+  const simd_level original = simdLevel();
+
+  Matrix<int, RANDOM_MATRIX_SIZE, RANDOM_MATRIX_SIZE> m;
+  initialise_bounded(m);
+
+  decltype(m) a;
+  initialise_bounded(a);
+
+  for (auto level : levels)
+  {
+    setSimdLevel(level);
+
+    decltype(m) sum        = m + a;
+    decltype(m) difference = m - a;
+    decltype(m) product    = m * a;
+    decltype(m) scaled     = 3 * m;
+
+    for (size_t i = 1; i <= RANDOM_MATRIX_SIZE; ++i)
+      for (size_t j = 1; j <= RANDOM_MATRIX_SIZE; ++j)
+      {
+        REQUIRE(sum.at(i, j) == m.at(i, j) + a.at(i, j));
+        REQUIRE(difference.at(i, j) == m.at(i, j) - a.at(i, j));
+        REQUIRE(product.at(i, j) == m.at(i, j) * a.at(i, j));
+        REQUIRE(scaled.at(i, j) == 3 * m.at(i, j));
+      }
+  }
+
+  setSimdLevel(original);
+}
+
+TEST_CASE("Every SIMD level broadcasts rows and columns the same way.")
+{
+  const simd_level original = simdLevel();
+
+  Matrix<int, RANDOM_MATRIX_SIZE, 20> m;
+  Matrix<int, 1, 20> row;
+  Matrix<int, RANDOM_MATRIX_SIZE, 1> column;
+  initialise_bounded(m);
+  initialise_bounded(row);
+  initialise_bounded(column);
+
+  for (auto level : levels)
+  {
+    setSimdLevel(level);
+
+    decltype(m) rowSum        = m + row;
+    decltype(m) columnProduct = column * m;
+    decltype(m) outer         = column - row;
+
+    for (size_t i = 1; i <= RANDOM_MATRIX_SIZE; ++i)
+      for (size_t j = 1; j <= 20; ++j)
+      {
+        REQUIRE(rowSum.at(i, j) == m.at(i, j) + row.at(1, j));
+        REQUIRE(columnProduct.at(i, j) == column.at(i, 1) * m.at(i, j));
+        REQUIRE(outer.at(i, j) == column.at(i, 1) - row.at(1, j));
+      }
+  }
+
+  setSimdLevel(original);
+}
+
+TEST_CASE("Every SIMD level sums stored matrices the same way.")
+{
+  const simd_level original = simdLevel();
+
+  Matrix<int, RANDOM_MATRIX_SIZE, 20> m;
+  Matrix<double, RANDOM_MATRIX_SIZE, 20> d;
+  initialise_random(d);
+  for (auto &elem : m)
+  {
+    elem = int(&elem - m.begin()) % 1000 - 500;
+  }
+
+  int expected     = 0;
+  double expectedD  = 0;
+  for (size_t i = 1; i <= RANDOM_MATRIX_SIZE; ++i)
+    for (size_t j = 1; j <= 20; ++j)
+    {
+      expected += m.at(i, j);
+      expectedD += d.at(i, j);
+    }
+
+  for (auto level : levels)
+  {
+    setSimdLevel(level);
+
+    REQUIRE(mat::sum(m) == expected);
+    REQUIRE(mat::sum(d) == Approx(expectedD));
+  }
+
+  setSimdLevel(original);
+}
+
+TEST_CASE("Every SIMD level transposes the same way.")
+{
+  const simd_level original = simdLevel();
+
+  Matrix<float, RANDOM_MATRIX_SIZE, 20> m;
+  initialise_random(m);
+
+  for (auto level : levels)
+  {
+    setSimdLevel(level);
+
+    Matrix<float, 20, RANDOM_MATRIX_SIZE> t = mat::transpose(m);
+
+    for (size_t i = 1; i <= 20; ++i)
+      for (size_t j = 1; j <= RANDOM_MATRIX_SIZE; ++j)
+      {
+        REQUIRE(t.at(i, j) == m.at(j, i));
+      }
+  }
+
+  setSimdLevel(original);
+}
@@ -0,0 +1,98 @@
+#include "Matrix.hpp"
+#include "StructuredMatrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+constexpr Matrix<int, 3, 3> testMatrix = { { 1, 2, 3 },
+                                           { 4, 5, 6 },
+                                           { 7, 8, 9 } };
+}  // namespace
+
+TEST_CASE("Structured matrices only store their packed elements.")
+{
+  REQUIRE(SymmetricMatrix<double, 10>::packedSize() == 55);
+  REQUIRE(TriangularMatrix<double, 10>::packedSize() == 55);
+  REQUIRE(DiagonalMatrix<double, 10>::packedSize() == 10);
+  REQUIRE(sizeof(SymmetricMatrix<double, 10>) == 55 * sizeof(double));
+}
+
+TEST_CASE("A symmetric matrix mirrors its upper triangle.")
+{
+  SymmetricMatrix<int, 3> s = testMatrix;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(s.at(i, j) == testMatrix.at(std::min(i, j), std::max(i, j)));
+    }
+
+  s.ref(3, 1) = 100;
+  REQUIRE(s.at(1, 3) == 100);
+}
+
+TEST_CASE("Triangular matrices read zero outside their triangle.")
+{
+  TriangularMatrix<int, 3> upper                  = testMatrix;
+  TriangularMatrix<int, 3, triangle::LOWER> lower = testMatrix;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(upper.at(i, j) == (i <= j ? testMatrix.at(i, j) : 0));
+      REQUIRE(lower.at(i, j) == (i >= j ? testMatrix.at(i, j) : 0));
+    }
+
+  upper.ref(1, 2) = 10;
+  REQUIRE(upper.at(1, 2) == 10);
+  REQUIRE_THROWS(upper.ref(2, 1) = 1);
+}
+
+TEST_CASE("A diagonal matrix only stores its diagonal.")
+{
+  const DiagonalMatrix<int, 3> d = testMatrix;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(d.at(i, j) == (i == j ? testMatrix.at(i, j) : 0));
+    }
+}
+
+TEST_CASE("Element-wise ops between the same structure keep the structure.")
+{
+  Matrix<double, 20, 20> a;
+  initialise_random(a);
+  Matrix<double, 20, 20> b;
+  initialise_random(b);
+
+  SymmetricMatrix<double, 20> sa = a;
+  SymmetricMatrix<double, 20> sb = b;
+  SymmetricMatrix<double, 20> s  = 2.0 * sa + sb;
+
+  const TriangularMatrix<double, 20, triangle::LOWER> la = a;
+  const TriangularMatrix<double, 20, triangle::LOWER> lb = b;
+  const TriangularMatrix<double, 20, triangle::LOWER> l  = la * lb;
+
+  for (size_t i = 1; i <= 20; ++i)
+    for (size_t j = 1; j <= 20; ++j)
+    {
+      REQUIRE(s.at(i, j) == 2.0 * sa.at(i, j) + sb.at(i, j));
+      REQUIRE(l.at(i, j) == la.at(i, j) * lb.at(i, j));
+    }
+}
+
+TEST_CASE("Structured matrices mix with dense matrices in expressions.")
+{
+  DiagonalMatrix<int, 3> d = mat::identity<int, 3>();
+  Matrix<int, 3, 3> ans    = testMatrix + d;
+
+  for (size_t i = 1; i <= 3; ++i)
+    for (size_t j = 1; j <= 3; ++j)
+    {
+      REQUIRE(ans.at(i, j) == testMatrix.at(i, j) + (i == j ? 1 : 0));
+    }
+}
@@ -2,7 +2,10 @@
 #ifndef JUMBATM_MATRIX_TEST_HELPERS_INCLUDED
 #define JUMBATM_MATRIX_TEST_HELPERS_INCLUDED
 
+#include <array>
+#include <iostream>
 #include <random>
+#include <tuple>
 
 #include "Matrix.hpp"
 
@@ -28,7 +31,10 @@ template <typename Matrix>
 void initialise_random(Matrix &m)
 {
   std::random_device rd;
-  mat_for_each(m, [&rd](auto &elem) { elem = rd(); });
+  mat::assign_all(
+      std::tie(m),
+      mat::random<typename Matrix::value_type, Matrix::rows(), Matrix::cols()>(
+          rd()));
 }
 
 template <typename T, size_t size>
@@ -0,0 +1,176 @@
+#include <filesystem>
+#include <string>
+
+#include "Matrix.hpp"
+#include "TiledMatrix.hpp"
+#include "catch.hpp"
+#include "test_helpers.hpp"
+
+using namespace mat;
+
+namespace
+{
+// Removes the backing file when the test is done with it.
+struct TemporaryFile
+{
+  const std::filesystem::path path;
+
+  TemporaryFile(const std::string &name)
+    : path(std::filesystem::temp_directory_path() / name)
+  {
+    std::filesystem::remove(path);
+  }
+  ~TemporaryFile()
+  {
+    std::filesystem::remove(path);
+  }
+};
+
+constexpr size_t ROWS    = 45;
+constexpr size_t COLUMNS = 37;  // Neither is a multiple of the tile size.
+
+// Two 8x8 tiles of doubles; small enough to force evictions.
+constexpr size_t TWO_TILES = 2 * 8 * 8 * sizeof(double);
+
+using Tiled = TiledMatrix<double, ROWS, COLUMNS, 8, 8>;
+}  // namespace
+
+TEST_CASE("A tiled matrix round-trips through its file.")
+{
+  TemporaryFile file("mat_tiled_round_trip.bin");
+
+  Matrix<double, ROWS, COLUMNS> dense = mat::random<double, ROWS, COLUMNS>(3);
+  {
+    Tiled tiled(file.path, TWO_TILES);
+    tiled.assign(dense);
+  }
+
+  Tiled reopened(file.path, TWO_TILES);
+  for (size_t i = 1; i <= ROWS; ++i)
+    for (size_t j = 1; j <= COLUMNS; ++j)
+    {
+      REQUIRE(reopened.at(i, j) == dense.at(i, j));
+    }
+}
+
+TEST_CASE("Tiled matrices take part in element-wise expressions.")
+{
+  TemporaryFile fileA("mat_tiled_a.bin");
+  TemporaryFile fileB("mat_tiled_b.bin");
+  TemporaryFile fileC("mat_tiled_c.bin");
+
+  Matrix<double, ROWS, COLUMNS> a = mat::random<double, ROWS, COLUMNS>(1);
+  Matrix<double, ROWS, COLUMNS> b = mat::random<double, ROWS, COLUMNS>(2);
+  Matrix<double, 1, COLUMNS> bias = mat::random<double, 1, COLUMNS>(3);
+
+  Tiled tiledA(fileA.path, TWO_TILES);
+  Tiled tiledB(fileB.path, TWO_TILES);
+  Tiled tiledC(fileC.path, TWO_TILES);
+  tiledA.assign(a);
+  tiledB.assign(b);
+
+  tiledC.assign(tiledA * 2.0 - tiledB + bias);
+
+  for (size_t i = 1; i <= ROWS; ++i)
+    for (size_t j = 1; j <= COLUMNS; ++j)
+    {
+      REQUIRE(tiledC.at(i, j) == a.at(i, j) * 2.0 - b.at(i, j) + bias.at(1, j));
+    }
+}
+
+TEST_CASE("Tiled matrices can be transposed out of core.")
+{
+  TemporaryFile fileA("mat_tiled_transpose_a.bin");
+  TemporaryFile fileT("mat_tiled_transpose_t.bin");
+
+  Matrix<double, ROWS, COLUMNS> a = mat::random<double, ROWS, COLUMNS>(4);
+
+  Tiled tiledA(fileA.path, TWO_TILES);
+  tiledA.assign(a);
+
+  TiledMatrix<double, COLUMNS, ROWS, 8, 8> tiledT(fileT.path, TWO_TILES);
+  tiledT.assign(mat::transpose(tiledA));
+
+  Matrix<double, COLUMNS, ROWS> dense = tiledT;
+  for (size_t i = 1; i <= COLUMNS; ++i)
+    for (size_t j = 1; j <= ROWS; ++j)
+    {
+      REQUIRE(dense.at(i, j) == a.at(j, i));
+    }
+}
+
+TEST_CASE("A tiled matrix can be updated from an expression of itself.")
+{
+  TemporaryFile file("mat_tiled_in_place.bin");
+
+  Matrix<double, ROWS, COLUMNS> a = mat::random<double, ROWS, COLUMNS>(5);
+
+  Tiled tiled(file.path, TWO_TILES);
+  tiled.assign(a);
+  tiled.assign(tiled + 1.0);
+
+  for (size_t i = 1; i <= ROWS; ++i)
+    for (size_t j = 1; j <= COLUMNS; ++j)
+    {
+      REQUIRE(tiled.at(i, j) == a.at(i, j) + 1.0);
+    }
+}
+
+TEST_CASE("A tiled matrix can't be assigned its own transpose.")
+{
+  TemporaryFile file("mat_tiled_self_transpose.bin");
+
+  Matrix<double, 20, 20> a = mat::random<double, 20, 20>(6);
+
+  TiledMatrix<double, 20, 20, 8, 8> tiled(file.path, TWO_TILES);
+  tiled.assign(a);
+  REQUIRE_THROWS(tiled.assign(mat::transpose(tiled)));
+  REQUIRE_THROWS(tiled.assign(a + mat::transpose(tiled) * 2.0));
+
+  // Nothing was overwritten.
+  for (size_t i = 1; i <= 20; ++i)
+    for (size_t j = 1; j <= 20; ++j)
+    {
+      REQUIRE(tiled.at(i, j) == a.at(i, j));
+    }
+}
+
+TEST_CASE("The memory budget bounds the cache and the read-ahead together.")
+{
+  TemporaryFile fileA("mat_tiled_budget_a.bin");
+  TemporaryFile fileB("mat_tiled_budget_b.bin");
+
+  REQUIRE_THROWS(Tiled(fileA.path, 8 * 8 * sizeof(double) - 1));
+
+  Matrix<double, ROWS, COLUMNS> a = mat::random<double, ROWS, COLUMNS>(7);
+
+  // One tile: no room to read ahead, but still correct.
+  Tiled tiledA(fileA.path, TWO_TILES / 2);
+  Tiled tiledB(fileB.path, TWO_TILES);
+  tiledA.assign(a);
+  tiledB.assign(tiledA * 3.0);
+
+  for (size_t i = 1; i <= ROWS; ++i)
+    for (size_t j = 1; j <= COLUMNS; ++j)
+    {
+      REQUIRE(tiledB.at(i, j) == a.at(i, j) * 3.0);
+    }
+}
+
+TEST_CASE("A failed tile read inside an expression throws.")
+{
+  TemporaryFile fileA("mat_tiled_truncated_a.bin");
+  TemporaryFile fileB("mat_tiled_truncated_b.bin");
+
+  Matrix<double, ROWS, COLUMNS> a = mat::random<double, ROWS, COLUMNS>(8);
+
+  Tiled tiledA(fileA.path, TWO_TILES);
+  Tiled tiledB(fileB.path, TWO_TILES);
+  tiledA.assign(a);
+
+  // Under the live matrix, so that the tiles it hasn't cached can't be read.
+  std::filesystem::resize_file(fileA.path, 0);
+
+  REQUIRE_THROWS(tiledB.assign(tiledA * 2.0));
+  REQUIRE_THROWS(tiledB.assign(tiledA));
+}